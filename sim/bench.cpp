@@ -0,0 +1,151 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "simulation.hpp"
+
+/** Host benchmark of Heating calls done by main loop
+
+Real Heating runs in simulator harness (see simulation.hpp) and host
+time is measured for all calls of Heating::process() and start(), result
+is cost per heating period.
+
+Getters read by screen in each drawn frame are too short for clock of
+harness, so they are measured separately in loop over many frames:
+- before: accumulators in uW * ticks and ticks, each getter divide them
+  by 64-bit division (code of Heating before incremental accumulators),
+- after: values prepared once per period, getters are plain loads.
+Both variants read same random states and their results are compared.
+Host compiler replaces 64-bit division by constant with multiplication,
+on Cortex-M0 it is call of libgcc helper as division by variable, so
+constant divisors are read from volatile variables.
+*/
+
+static const int STATES = 1024;  // random states of accumulators, power of 2
+static const long FRAMES = 1L << 24;  // frames in one measured loop
+static const int REPEATS = 5;  // measured loops, fastest is used
+
+static volatile int64_t core_freq = board::Clock::CORE_FREQ;
+static volatile int64_t ms_per_s = 1000;
+static volatile int64_t s_per_h = 3600;
+
+/** Accumulators and getters before incremental accumulators */
+struct Before {
+    int64_t power_uwpt;  // uW * period_ticks
+    int64_t energy_uwt;  // uW * ticks
+    int64_t steady_ticks;  // ticks
+    int period_ticks;
+
+    int get_power_mw(int64_t ms) const {
+        return power_uwpt / period_ticks / ms;
+    }
+
+    int get_energy_mwh(int64_t freq, int64_t ms, int64_t h) const {
+        return energy_uwt / freq / ms / h;
+    }
+
+    int get_steady_ms(int64_t freq, int64_t ms) const {
+        return steady_ticks / (freq / ms);
+    }
+};
+
+/** Values prepared once per period, getters are loads */
+struct After {
+    int power_mw;
+    int energy_mwh;
+    int steady_ms;
+};
+
+static Before before[STATES];
+static After after[STATES];
+
+static void prepare_states() {
+    std::mt19937 random(1);
+    for (int i = 0; i < STATES; i++) {
+        Before &b = before[i];
+        b.period_ticks = (random() % 2 ? Heating::PERIOD_TIME_MS : Heating::PERIOD_TIME_MIN_MS) * (board::Clock::CORE_FREQ / 1000);
+        b.power_uwpt = (int64_t)(random() % Heating::HEATING_POWER_MAX) * b.period_ticks * 1000;
+        b.energy_uwt = (int64_t)(random() % 100000) * 3600 * 1000 * board::Clock::CORE_FREQ + random() % board::Clock::CORE_FREQ;
+        b.steady_ticks = (int64_t)(random() % Heating::STANDBY_TIME_MS) * (board::Clock::CORE_FREQ / 1000);
+        after[i].power_mw = b.get_power_mw(1000);
+        after[i].energy_mwh = b.get_energy_mwh(board::Clock::CORE_FREQ, 1000, 3600);
+        after[i].steady_ms = b.get_steady_ms(board::Clock::CORE_FREQ, 1000);
+    }
+}
+
+/** Read three getters in each frame, like screen::Main
+
+Arguments:
+    ns: fastest time of frame
+    function: reads getters of state, return sum of values
+
+Return:
+    sum of values over frames of one loop
+*/
+template <class F>
+static int64_t measure_frames(double &ns, F function) {
+    int64_t sum = 0;
+    ns = 0;
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        sum = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < FRAMES; frame++) {
+            sum += function(frame & (STATES - 1));
+            // values are read again in next frame, as after redraw of screen
+            asm volatile("" ::: "memory");
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double frame_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / FRAMES;
+        if (!repeat || frame_ns < ns) ns = frame_ns;
+    }
+    return sum;
+}
+
+int main(int argc, char *argv[]) {
+    Simulation::Config config;
+    sim::Plant::Config plant;
+    config.duration_s = 600;
+    config.timing = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--duration") && i + 1 < argc) {
+            config.duration_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--setpoint") && i + 1 < argc) {
+            config.setpoint_c = atof(argv[++i]);
+        } else {
+            printf("usage: %s [--duration s] [--setpoint C]\n", argv[0]);
+            return 1;
+        }
+    }
+    Simulation simulation(config, plant);
+    simulation.run();
+    const Simulation::Timing &timing = simulation.get_timing();
+    if (!timing.periods) return 1;
+    double heating_ns = timing.heating_ns / timing.periods;
+
+    prepare_states();
+    double before_ns, after_ns;
+    int64_t before_sum = measure_frames(before_ns, [](int i) {
+        const int64_t freq = core_freq, ms = ms_per_s, h = s_per_h;
+        return before[i].get_power_mw(ms) + before[i].get_energy_mwh(freq, ms, h) + before[i].get_steady_ms(freq, ms);
+    });
+    int64_t after_sum = measure_frames(after_ns, [](int i) {
+        return after[i].power_mw + after[i].energy_mwh + after[i].steady_ms;
+    });
+
+    Heating &heating = simulation.get_heating();
+    printf("periods:           %8ld\n", timing.periods);
+    printf("heating calls:     %8.1f ns/period\n", heating_ns);
+    printf("getters before:    %8.2f ns/frame (64-bit division)\n", before_ns);
+    printf("getters after:     %8.2f ns/frame (loads)\n", after_ns);
+    printf("energy:            %8d mWh (plant %.0f mWh)\n", heating.get_energy_mwh(), simulation.get_plant().get_energy() / 3.6);
+    if (before_sum != after_sum) {
+        printf("error: getters before and after return different values\n");
+        return 1;
+    }
+    if (heating_ns <= 0 || before_ns <= 0 || after_ns <= 0) {
+        printf("error: measured time is not positive, clock overhead is larger than measured code\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstring>
+
+#include "board/clock.hpp"
+#include "telemetry.hpp"
+
+/** Host decoder of binary telemetry from debug UART
+
+Reads stream of COBS frames (from file or stdin) and prints control
+frames, trace records or profiler statistics as CSV to stdout. Invalid frames are counted
+and reported to stderr.
+*/
+
+static const double CORE_FREQ = board::Clock::CORE_FREQ;
+
+static void print_control(const uint8_t *payload) {
+    Telemetry::Control c;
+    c.unpack(payload);
+    printf("%.6f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+        c.ticks / CORE_FREQ, c.pen_temperature_mc, c.set_point_mc, c.cpu_temperature_mc,
+        c.requested_power_mw, c.power_mw, c.supply_voltage_mv_idle, c.supply_voltage_mv_heat,
+        c.pen_current_ma, c.pen_resistance_mo, c.pid_p, c.pid_i, c.pid_d,
+        c.estimated_temperature_mc);
+}
+
+static void print_trace(const uint8_t *payload) {
+    printf("%.6f,%d,%d,%d\n",
+        Telemetry::read_u32(payload + 2) / CORE_FREQ, payload[0], payload[1],
+        (int32_t)Telemetry::read_u32(payload + 6));
+}
+
+static void print_profile(const uint8_t *payload) {
+    printf("%d", payload[0]);
+    for (int i = 0; i < 4; i++) printf(",%u", Telemetry::read_u32(payload + 1 + i * 4));
+    for (int i = 0; i < 16; i++) printf(",%u", payload[17 + i * 2] | payload[18 + i * 2] << 8);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    Telemetry::Type output = Telemetry::Type::CONTROL;
+    const char *file_name = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace")) {
+            output = Telemetry::Type::TRACE;
+        } else if (!strcmp(argv[i], "--profile")) {
+            output = Telemetry::Type::PROFILE;
+        } else if (argv[i][0] != '-' && !file_name) {
+            file_name = argv[i];
+        } else {
+            printf("usage: %s [--trace | --profile] [file]\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE *f = file_name ? fopen(file_name, "rb") : stdin;
+    if (!f) {
+        fprintf(stderr, "can not read %s\n", file_name);
+        return 1;
+    }
+    if (output == Telemetry::Type::TRACE) {
+        printf("time_s,event,param,value\n");
+    } else if (output == Telemetry::Type::PROFILE) {
+        printf("probe,count,min,max,mean");
+        for (int i = 0; i < 16; i++) printf(",hist%d", i);
+        printf("\n");
+    } else {
+        printf("time_s,pen_temperature_mc,set_point_mc,cpu_temperature_mc,requested_power_mw,power_mw,"
+            "supply_voltage_mv_idle,supply_voltage_mv_heat,pen_current_ma,pen_resistance_mo,pid_p,pid_i,pid_d,estimated_temperature_mc\n");
+    }
+    uint8_t frame[Telemetry::FRAME_SIZE_MAX];
+    uint8_t payload[Telemetry::FRAME_SIZE_MAX];
+    int len = 0;
+    int frames = 0;
+    int errors = 0;
+    int ch;
+    while ((ch = fgetc(f)) != EOF) {
+        if (ch != lib::Cobs::DELIMITER) {
+            // too long frame is invalid, it is dropped at next delimiter
+            if (len < Telemetry::FRAME_SIZE_MAX) frame[len] = ch;
+            len++;
+            continue;
+        }
+        if (!len) continue;
+        Telemetry::Type type;
+        int size = len <= Telemetry::FRAME_SIZE_MAX ? Telemetry::decode(frame, len, type, payload) : -1;
+        len = 0;
+        if (size < 0) {
+            errors++;
+            continue;
+        }
+        frames++;
+        if (type != output) continue;
+        if (type == Telemetry::Type::CONTROL && size == Telemetry::Control::SIZE) {
+            print_control(payload);
+        } else if (type == Telemetry::Type::TRACE && size == 10) {
+            print_trace(payload);
+        } else if (type == Telemetry::Type::PROFILE && size == 49) {
+            print_profile(payload);
+        }
+    }
+    if (f != stdin) fclose(f);
+    fprintf(stderr, "frames: %d, invalid: %d\n", frames, errors);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+namespace sim {
+
+/** Emulator of internal flash storage area
+
+Same interface as board::Flash. Emulate NOR flash: erase set all bits
+of page, program can only clear bits of erased half-word. Power can be
+cut after given number of operations, interrupted operation leave
+random content (partially erased page or partially programmed half-word)
+and all next operations fail until power_on(). Single operation can also
+fail while power stays on (erase or program error), it leave same random
+content and next operations work.
+*/
+template <unsigned PAGE_SIZE_ = 1024, int PAGES_ = 2>
+class Flash {
+public:
+    static const unsigned PAGE_SIZE = PAGE_SIZE_;
+    static const int PAGES = PAGES_;
+
+private:
+    static const unsigned WORDS = PAGE_SIZE / 2;
+
+    uint16_t _data[PAGES][WORDS];
+    unsigned _erases[PAGES] = {};
+    unsigned _programs = 0;
+    long _power_cut = -1;  // operations to power cut, -1 never
+    long _fail = -1;  // operations to single failed operation, -1 never
+    bool _powered = true;
+    std::mt19937 _random;
+
+    /** Count operation
+
+    Return:
+        true if operation is done, false if it fails or power is cut during it
+    */
+    bool _operation() {
+        if (_fail >= 0 && _fail-- == 0) return false;
+        if (_power_cut < 0) return true;
+        if (_power_cut-- > 0) return true;
+        _powered = false;
+        return false;
+    }
+
+public:
+    Flash(unsigned seed=1) : _random(seed) {
+        for (auto &page : _data) {
+            for (auto &word : page) word = 0xffff;
+        }
+    }
+
+    uint16_t read(const int page, const unsigned offset) const {
+        return _data[page][offset / 2];
+    }
+
+    bool erase(const int page) {
+        if (!_powered) return false;
+        if (!_operation()) {
+            // interrupted or failed erase, part of page is erased, rest keep random bits
+            unsigned erased = _random() % WORDS;
+            for (unsigned i = 0; i < WORDS; i++) {
+                if (i < erased) _data[page][i] = 0xffff;
+                else _data[page][i] |= _random();
+            }
+            return false;
+        }
+        _erases[page]++;
+        for (auto &word : _data[page]) word = 0xffff;
+        return true;
+    }
+
+    bool program(const int page, const unsigned offset, const uint16_t value) {
+        uint16_t &word = _data[page][offset / 2];
+        if (!_powered) return false;
+        if (!_operation()) {
+            // interrupted or failed program, only some bits are cleared
+            word &= value | _random();
+            return false;
+        }
+        // STM32 does not program half-word which is not erased
+        if (word != 0xffff) return false;
+        _programs++;
+        word = value;
+        return true;
+    }
+
+    /** Cut power after number of operations
+
+    Arguments:
+        operations: operations done before power cut, -1 never
+    */
+    void set_power_cut(const long operations) {
+        _power_cut = operations;
+    }
+
+    /** Fail one operation while power stays on
+
+    Arguments:
+        operations: operations done before failed one, -1 never
+    */
+    void set_fail(const long operations) {
+        _fail = operations;
+    }
+
+    bool is_powered() const {
+        return _powered;
+    }
+
+    void power_on() {
+        _powered = true;
+        _power_cut = -1;
+        _fail = -1;
+    }
+
+    unsigned get_erases(const int page) const {
+        return _erases[page];
+    }
+
+    unsigned get_programs() const {
+        return _programs;
+    }
+};
+
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "lib/kv_store.hpp"
+#include "flash.hpp"
+
+/** Power cut test of lib::KvStore on emulated flash
+
+Each cycle boot store from flash, check restored values, then write
+random batches of values and cut power after random number of flash
+operations. Before power cut one random operation fails while power stays
+on, so next flushes continue after failed erase or program. Value restored
+after power cut must be last flushed value or value from interrupted or
+failed flush, never older value or garbage.
+*/
+
+static const int KEYS = 27;  // same as Settings::Key::COUNT
+static const int BATCHES_MAX = 20;  // flushes between power cuts
+static const int OPERATIONS_MAX = 2000;  // flash operations to power cut
+
+typedef sim::Flash<> Flash;
+typedef lib::KvStore<Flash, KEYS> Store;
+
+struct Model {
+    bool stored[KEYS] = {};
+    uint32_t durable[KEYS] = {};  // last successfully flushed values
+    // values set after last successful flush, each may be written or not
+    // (failed flush can write part of values and next flush is not done)
+    std::vector<uint32_t> candidates[KEYS];
+
+    bool is_candidate(const int key, const uint32_t value) const {
+        for (uint32_t candidate : candidates[key]) {
+            if (candidate == value) return true;
+        }
+        return false;
+    }
+
+    /** Check restored values and accept them as durable
+
+    Return:
+        number of wrong values
+    */
+    int check(const Store &store) {
+        int errors = 0;
+        for (int key = 0; key < KEYS; key++) {
+            uint32_t value = 0;
+            bool restored = store.get(key, value);
+            bool ok;
+            if (!restored) {
+                ok = !stored[key];
+            } else {
+                ok = (stored[key] && value == durable[key]) || is_candidate(key, value);
+            }
+            if (!ok) {
+                fprintf(stderr, "key %d: restored %s %08x, durable %08x, candidates %d\n",
+                    key, restored ? "" : "(none)", restored ? value : 0, durable[key], (int)candidates[key].size());
+                errors++;
+                continue;
+            }
+            stored[key] = restored;
+            durable[key] = value;
+            candidates[key].clear();
+        }
+        return errors;
+    }
+
+    void set(Store &store, const int key, const uint32_t value) {
+        store.set(key, value);
+        candidates[key].push_back(value);
+    }
+
+    void flushed() {
+        for (int key = 0; key < KEYS; key++) {
+            if (candidates[key].empty()) continue;
+            stored[key] = true;
+            durable[key] = candidates[key].back();
+            candidates[key].clear();
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+    long cycles = 10000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--cycles") && i + 1 < argc) {
+            cycles = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else {
+            printf("usage: %s [--cycles n] [--seed n]\n", argv[0]);
+            return 1;
+        }
+    }
+    std::mt19937 random(seed);
+    Flash flash(seed);
+    Model model;
+    int errors = 0;
+    long flushes = 0;
+    for (long cycle = 0; cycle < cycles; cycle++) {
+        Store store(flash);
+        store.load();
+        errors += model.check(store);
+        flash.set_power_cut(random() % OPERATIONS_MAX);
+        flash.set_fail(random() % OPERATIONS_MAX);
+        for (int batch = random() % BATCHES_MAX; batch >= 0 && flash.is_powered(); batch--) {
+            for (int changes = 1 + random() % 4; changes > 0; changes--) {
+                // few keys change often (presets, counters), others rarely
+                int key = random() % 4 ? random() % 4 : random() % KEYS;
+                model.set(store, key, random());
+            }
+            if (store.flush()) {
+                model.flushed();
+                flushes++;
+            }
+        }
+        flash.power_on();
+    }
+    Store store(flash);
+    store.load();
+    errors += model.check(store);
+    printf("cycles:    %8ld\n", cycles);
+    printf("flushes:   %8ld\n", flushes);
+    printf("programs:  %8u\n", flash.get_programs());
+    for (int page = 0; page < Flash::PAGES; page++) {
+        printf("erases %d:  %8u\n", page, flash.get_erases(page));
+    }
+    printf("errors:    %8d\n", errors);
+    return errors ? 1 : 0;
+}
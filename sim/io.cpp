@@ -0,0 +1,35 @@
+#include "io/reg/cortexm/nvic.hpp"
+#include "io/reg/cortexm/systick.hpp"
+#include "io/reg/stm32/f0/adc.hpp"
+#include "io/reg/stm32/f0/dma.hpp"
+#include "io/reg/stm32/f0/flash.hpp"
+#include "io/reg/stm32/f0/gpio.hpp"
+#include "io/reg/stm32/f0/rcc.hpp"
+#include "io/reg/stm32/f0/syscfg.hpp"
+#include "io/reg/stm32/f0/sysmem.hpp"
+#include "io/reg/stm32/f0/tim.hpp"
+#include "io/reg/stm32/f0/usart.hpp"
+
+namespace io {
+
+bool Nvic::isr_enabled = false;
+Nvic NVIC;
+Systick SYSTICK;
+Adc ADC;
+Dma DMA1;
+Flash FLASH;
+Gpio GPIOA;
+Gpio GPIOB;
+Rcc RCC;
+Syscfg SYSCFG;
+Tim TIM16;
+Usart USART1;
+
+// typical factory calibration of STM32F030
+Sysmem SYSMEM = {
+    1773,  // TEMP30_CAL
+    1523,  // VREFINT_CAL
+    1316,  // TEMP110_CAL
+};
+
+}
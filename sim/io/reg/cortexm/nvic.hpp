@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+/** Nested vectored interrupt controller
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+class Nvic {
+    uint32_t _enabled = 0;
+    uint32_t _pending = 0;
+
+public:
+    static bool isr_enabled;
+
+    static void isr_enable() {
+        isr_enabled = true;
+    }
+
+    static void isr_disable() {
+        isr_enabled = false;
+    }
+
+    void iser(unsigned isr) {
+        _enabled |= 1u << isr;
+    }
+
+    void icer(unsigned isr) {
+        _enabled &= ~(1u << isr);
+    }
+
+    void ispr(unsigned isr) {
+        _pending |= 1u << isr;
+    }
+
+    void icpr(unsigned isr) {
+        _pending &= ~(1u << isr);
+    }
+
+    bool is_enabled(unsigned isr) const {
+        return isr_enabled && (_enabled & (1u << isr));
+    }
+};
+
+extern Nvic NVIC;
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+/** System timer
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Systick {
+    union Csr {
+        uint32_t r;
+        struct {
+            uint32_t ENABLE : 1;
+            uint32_t TICKINT : 1;
+            uint32_t CLKSOURCE : 1;
+            uint32_t : 13;
+            uint32_t COUNTFLAG : 1;
+            uint32_t : 15;
+        } b;
+        struct Clksource {
+            enum {
+                EXTERNAL = 0,
+                PROCESSOR = 1,
+            };
+        };
+        Csr(uint32_t r=0) : r(r) {}
+    } CSR;
+    struct {
+        uint32_t RELOAD;
+    } LOAD;
+    struct {
+        uint32_t CURRENT;
+    } VAL;
+};
+
+extern Systick SYSTICK;
+
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+
+/** Analog to digital converter
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Adc {
+    union Isr {
+        // flags are cleared by writing 1
+        struct W1c {
+            uint32_t value;
+            W1c &operator=(uint32_t mask) {
+                value &= ~mask;
+                return *this;
+            }
+            operator uint32_t() const {
+                return value;
+            }
+        } r;
+        struct {
+            uint32_t ADRDY : 1;
+            uint32_t EOSMP : 1;
+            uint32_t EOC : 1;
+            uint32_t EOSEQ : 1;
+            uint32_t OVR : 1;
+            uint32_t : 2;
+            uint32_t AWD : 1;
+            uint32_t : 24;
+        } b;
+        Isr(uint32_t r=0) : r{r} {}
+    } ISR;
+    union Ier {
+        uint32_t r;
+        struct {
+            uint32_t ADRDYIE : 1;
+            uint32_t EOSMPIE : 1;
+            uint32_t EOCIE : 1;
+            uint32_t EOSEQIE : 1;
+            uint32_t OVRIE : 1;
+            uint32_t : 2;
+            uint32_t AWDIE : 1;
+            uint32_t : 24;
+        } b;
+        Ier(uint32_t r=0) : r(r) {}
+    } IER;
+    struct Cr {
+        // calibration finish immediately
+        struct Adcal {
+            Adcal &operator=(bool) {
+                return *this;
+            }
+            operator bool() const {
+                return false;
+            }
+        };
+        struct {
+            bool ADEN = false;
+            bool ADDIS = false;
+            bool ADSTART = false;
+            bool ADSTP = false;
+            Adcal ADCAL;
+        } b;
+    } CR;
+    union Cfgr1 {
+        uint32_t r;
+        struct {
+            uint32_t DMAEN : 1;
+            uint32_t DMACFG : 1;
+            uint32_t SCANDIR : 1;
+            uint32_t RES : 2;
+            uint32_t ALIGN : 1;
+            uint32_t EXTSEL : 3;
+            uint32_t : 1;
+            uint32_t EXTEN : 2;
+            uint32_t OVRMOD : 1;
+            uint32_t CONT : 1;
+            uint32_t WAIT : 1;
+            uint32_t AUTOFF : 1;
+            uint32_t DISCEN : 1;
+            uint32_t : 5;
+            uint32_t AWDSGL : 1;
+            uint32_t AWDEN : 1;
+            uint32_t : 2;
+            uint32_t AWDCH : 5;
+            uint32_t : 1;
+        } b;
+        struct Res {
+            enum {
+                RES_12 = 0,
+                RES_10 = 1,
+                RES_8 = 2,
+                RES_6 = 3,
+            };
+        };
+        Cfgr1(uint32_t r=0) : r(r) {}
+    } CFGR1;
+    union Cfgr2 {
+        uint32_t r;
+        struct {
+            uint32_t : 30;
+            uint32_t CKMODE : 2;
+        } b;
+        struct Ckmode {
+            enum {
+                ADCCLK = 0,
+                PCLK_DIV2 = 1,
+                PCLK_DIV4 = 2,
+            };
+        };
+        Cfgr2(uint32_t r=0) : r(r) {}
+    } CFGR2;
+    union Smpr {
+        uint32_t r;
+        struct {
+            uint32_t SMP : 3;
+            uint32_t : 29;
+        } b;
+        struct Smp {
+            enum {
+                SMP_1_5 = 0,
+                SMP_7_5 = 1,
+                SMP_13_5 = 2,
+                SMP_28_5 = 3,
+                SMP_41_5 = 4,
+                SMP_55_5 = 5,
+                SMP_71_5 = 6,
+                SMP_239_5 = 7,
+            };
+        };
+        Smpr(uint32_t r=0) : r(r) {}
+    } SMPR;
+    union Tr {
+        uint32_t r;
+        struct {
+            uint32_t LT : 12;
+            uint32_t : 4;
+            uint32_t HT : 12;
+            uint32_t : 4;
+        } b;
+        Tr(uint32_t r=0) : r(r) {}
+    } TR;
+    union Chselr {
+        uint32_t r;
+        struct {
+            uint32_t CHSEL0 : 1;
+            uint32_t CHSEL1 : 1;
+            uint32_t CHSEL2 : 1;
+            uint32_t CHSEL3 : 1;
+            uint32_t CHSEL4 : 1;
+            uint32_t CHSEL5 : 1;
+            uint32_t CHSEL6 : 1;
+            uint32_t CHSEL7 : 1;
+            uint32_t CHSEL8 : 1;
+            uint32_t CHSEL9 : 1;
+            uint32_t CHSEL10 : 1;
+            uint32_t CHSEL11 : 1;
+            uint32_t CHSEL12 : 1;
+            uint32_t CHSEL13 : 1;
+            uint32_t CHSEL14 : 1;
+            uint32_t CHSEL15 : 1;
+            uint32_t CHSEL16 : 1;
+            uint32_t CHSEL17 : 1;
+            uint32_t CHSEL18 : 1;
+            uint32_t : 13;
+        } b;
+        Chselr(uint32_t r=0) : r(r) {}
+    } CHSELR;
+    struct {
+        uint16_t DATA = 0;
+    } DR;
+    union Ccr {
+        uint32_t r;
+        struct {
+            uint32_t : 22;
+            uint32_t VREFEN : 1;
+            uint32_t TSEN : 1;
+            uint32_t VBATEN : 1;
+            uint32_t : 7;
+        } b;
+        Ccr(uint32_t r=0) : r(r) {}
+    } CCR;
+};
+
+extern Adc ADC;
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+/** Peripheral base addresses of STM32F0
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+namespace base {
+
+static const size_t TIM2 = 0x40000000;
+static const size_t TIM3 = 0x40000400;
+static const size_t I2C1 = 0x40005400;
+static const size_t SYSCFG = 0x40010000;
+static const size_t ADC = 0x40012400;
+static const size_t TIM1 = 0x40012c00;
+static const size_t TIM16 = 0x40014400;
+static const size_t USART1 = 0x40013800;
+static const size_t DMA1 = 0x40020000;
+static const size_t RCC = 0x40021000;
+static const size_t FLASH = 0x40022000;
+static const size_t GPIOA = 0x48000000;
+static const size_t GPIOB = 0x48000400;
+static const size_t SYSMEM = 0x1ffff7b8;
+
+}
+}
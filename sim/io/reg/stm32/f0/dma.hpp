@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "io/reg/stm32/f0/base.hpp"
+
+/** Direct memory access controller
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Dma {
+    static const unsigned CHANNELS = 5;
+
+    struct Isr {
+        uint32_t r = 0;
+        static unsigned shift(unsigned ch) {
+            return (ch - 1) * 4;
+        }
+        bool GIF(unsigned ch) const {
+            return r & (1u << shift(ch));
+        }
+        bool TCIF(unsigned ch) const {
+            return r & (2u << shift(ch));
+        }
+        bool HTIF(unsigned ch) const {
+            return r & (4u << shift(ch));
+        }
+        bool TEIF(unsigned ch) const {
+            return r & (8u << shift(ch));
+        }
+    } ISR;
+    struct Ifcr {
+        Isr &isr;
+        void clear_flags(unsigned ch) {
+            isr.r &= ~(0xfu << Isr::shift(ch));
+        }
+    } IFCR{ISR};
+
+    struct Channel {
+        union Ccr {
+            uint32_t r;
+            struct {
+                uint32_t EN : 1;
+                uint32_t TCIE : 1;
+                uint32_t HTIE : 1;
+                uint32_t TEIE : 1;
+                uint32_t DIR : 1;
+                uint32_t CIRC : 1;
+                uint32_t PINC : 1;
+                uint32_t MINC : 1;
+                uint32_t PSIZE : 2;
+                uint32_t MSIZE : 2;
+                uint32_t PL : 2;
+                uint32_t MEM2MEM : 1;
+                uint32_t : 17;
+            } b;
+            struct Size {
+                enum {
+                    SIZE_8 = 0,
+                    SIZE_16 = 1,
+                    SIZE_32 = 2,
+                };
+            };
+            struct Pl {
+                enum {
+                    LOW = 0,
+                    MEDIUM = 1,
+                    HIGH = 2,
+                    VERY_HIGH = 3,
+                };
+            };
+            Ccr(uint32_t r=0) : r(r) {}
+        } CCR;
+        struct {
+            uint32_t NDT = 0;
+        } CNDTR;
+        struct {
+            size_t PAR = 0;
+        } CPAR;
+        struct {
+            size_t MAR = 0;
+        } CMAR;
+    } _channels[CHANNELS];
+
+    Channel &CHANNEL(unsigned ch) {
+        return _channels[ch - 1];
+    }
+};
+
+extern Dma DMA1;
+
+inline Dma &DMA(size_t) {
+    return DMA1;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+/** Flash interface
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Flash {
+    union Acr {
+        uint32_t r;
+        struct {
+            uint32_t LATENCY : 3;
+            uint32_t : 1;
+            uint32_t PRFTBE : 1;
+            uint32_t PRFTBS : 1;
+            uint32_t : 26;
+        } b;
+        Acr(uint32_t r=0) : r(r) {}
+    } ACR;
+};
+
+extern Flash FLASH;
+
+}
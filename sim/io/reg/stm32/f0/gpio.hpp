@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include "io/reg/stm32/f0/base.hpp"
+
+/** General purpose I/O
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Gpio {
+    struct Moder {
+        uint32_t r = 0;
+        struct Mode {
+            enum {
+                INPUT = 0,
+                OUTPUT = 1,
+                AF = 2,
+                ANALOG = 3,
+            };
+        };
+        void set(unsigned pin, uint32_t mode) {
+            r = (r & ~(3u << (pin * 2))) | (mode << (pin * 2));
+        }
+    } MODER;
+    struct Otyper {
+        uint32_t r = 0;
+        struct Otype {
+            enum {
+                PUSH_PULL = 0,
+                OPEN_DRAIN = 1,
+            };
+        };
+        void set(unsigned pin, uint32_t otype) {
+            r = (r & ~(1u << pin)) | (otype << pin);
+        }
+    } OTYPER;
+    struct Ospeedr {
+        uint32_t r = 0;
+        struct Ospeed {
+            enum {
+                LOW = 0,
+                MEDIUM = 1,
+                FAST = 2,
+                HIGH = 3,
+            };
+        };
+        void set(unsigned pin, uint32_t ospeed) {
+            r = (r & ~(3u << (pin * 2))) | (ospeed << (pin * 2));
+        }
+    } OSPEEDR;
+    struct Pupdr {
+        uint32_t r = 0;
+        struct Pupd {
+            enum {
+                OFF = 0,
+                PULL_UP = 1,
+                PULL_DOWN = 2,
+            };
+        };
+        void set(unsigned pin, uint32_t pupd) {
+            r = (r & ~(3u << (pin * 2))) | (pupd << (pin * 2));
+        }
+    } PUPDR;
+    struct Idr {
+        uint32_t r = 0;
+        bool get(unsigned pin) const {
+            return r & (1u << pin);
+        }
+    } IDR;
+    struct Odr {
+        uint32_t r = 0;
+        bool get(unsigned pin) const {
+            return r & (1u << pin);
+        }
+    } ODR;
+    struct Bsrr {
+        Odr &odr;
+        void set(unsigned pin) {
+            odr.r |= 1u << pin;
+        }
+        void clr(unsigned pin) {
+            odr.r &= ~(1u << pin);
+        }
+    } BSRR{ODR};
+    struct Afr {
+        uint32_t r[2] = {0, 0};
+        void set(unsigned pin, uint32_t af) {
+            r[pin / 8] = (r[pin / 8] & ~(0xfu << (pin % 8 * 4))) | (af << (pin % 8 * 4));
+        }
+    } AFR;
+};
+
+extern Gpio GPIOA;
+extern Gpio GPIOB;
+
+inline Gpio &GPIO(size_t base) {
+    return (base == base::GPIOB) ? GPIOB : GPIOA;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/** Interrupt numbers of STM32F0
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+namespace isr {
+
+enum Isr {
+    WWDG_isr = 0,
+    RTC_isr = 2,
+    FLASH_isr = 3,
+    RCC_isr = 4,
+    EXTI0_1_isr = 5,
+    EXTI2_3_isr = 6,
+    EXTI4_15_isr = 7,
+    DMA1_CH1_isr = 9,
+    DMA1_CH2_3_isr = 10,
+    DMA1_CH4_5_isr = 11,
+    ADC_isr = 12,
+    TIM1_BRK_UP_TRG_COM_isr = 13,
+    TIM1_CC_isr = 14,
+    TIM3_isr = 16,
+    TIM14_isr = 19,
+    TIM16_isr = 21,
+    TIM17_isr = 22,
+    I2C1_isr = 23,
+    SPI1_isr = 25,
+    USART1_isr = 27,
+};
+
+}
+}
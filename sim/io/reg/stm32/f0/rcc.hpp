@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+/** Reset and clock control
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Rcc {
+    union Cr {
+        uint32_t r;
+        struct {
+            uint32_t HSION : 1;
+            uint32_t HSIRDY : 1;
+            uint32_t : 30;
+        } b;
+        Cr(uint32_t r=0) : r(r) {}
+    } CR;
+    union Cfgr {
+        uint32_t r;
+        struct {
+            uint32_t SW : 2;
+            uint32_t SWS : 2;
+            uint32_t HPRE : 4;
+            uint32_t PPRE : 3;
+            uint32_t : 21;
+        } b;
+        struct Sw {
+            enum {
+                HSI = 0,
+                HSE = 1,
+                PLL = 2,
+            };
+        };
+        struct Hpre {
+            enum {
+                DIV_1 = 0,
+            };
+        };
+        struct Ppre {
+            enum {
+                DIV_1 = 0,
+            };
+        };
+        Cfgr(uint32_t r=0) : r(r) {}
+    } CFGR;
+    union Ahbenr {
+        uint32_t r;
+        struct {
+            uint32_t DMA1 : 1;
+            uint32_t : 16;
+            uint32_t GPIOA : 1;
+            uint32_t GPIOB : 1;
+            uint32_t : 13;
+        } b;
+        Ahbenr(uint32_t r=0) : r(r) {}
+    } AHBENR;
+    union Apb2enr {
+        uint32_t r;
+        struct {
+            uint32_t SYSCFG : 1;
+            uint32_t : 8;
+            uint32_t ADC : 1;
+            uint32_t : 1;
+            uint32_t TIM1 : 1;
+            uint32_t : 2;
+            uint32_t USART1 : 1;
+            uint32_t : 1;
+            uint32_t TIM15 : 1;
+            uint32_t TIM16 : 1;
+            uint32_t TIM17 : 1;
+            uint32_t : 13;
+        } b;
+        Apb2enr(uint32_t r=0) : r(r) {}
+    } APB2ENR;
+    union Apb1enr {
+        uint32_t r;
+        struct {
+            uint32_t TIM2 : 1;
+            uint32_t TIM3 : 1;
+            uint32_t : 19;
+            uint32_t I2C1 : 1;
+            uint32_t : 10;
+        } b;
+        Apb1enr(uint32_t r=0) : r(r) {}
+    } APB1ENR;
+};
+
+extern Rcc RCC;
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include "io/reg/stm32/f0/base.hpp"
+
+/** System configuration controller
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Syscfg {
+    union Cfgr1 {
+        uint32_t r;
+        struct {
+            uint32_t MEM_MODE : 2;
+            uint32_t : 6;
+            uint32_t ADC_DMA_RMP : 1;
+            uint32_t USART1_TX_DMA_RMP : 1;
+            uint32_t USART1_RX_DMA_RMP : 1;
+            uint32_t TIM16_DMA_RMP : 1;
+            uint32_t TIM17_DMA_RMP : 1;
+            uint32_t : 19;
+        } b;
+        Cfgr1(uint32_t r=0) : r(r) {}
+    } CFGR1;
+};
+
+extern Syscfg SYSCFG;
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+/** Factory calibration values in system memory
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Sysmem {
+    uint16_t TEMP30_CAL;
+    uint16_t VREFINT_CAL;
+    uint16_t TEMP110_CAL;
+};
+
+extern Sysmem SYSMEM;
+
+}
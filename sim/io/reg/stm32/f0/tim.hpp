@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "io/reg/stm32/f0/base.hpp"
+
+/** General purpose timer
+(host simulator replacement of io register library)
+*/
+
+namespace io {
+
+struct Tim {
+    union Cr1 {
+        uint32_t r;
+        struct {
+            uint32_t CEN : 1;
+            uint32_t UDIS : 1;
+            uint32_t URS : 1;
+            uint32_t OPM : 1;
+            uint32_t DIR : 1;
+            uint32_t CMS : 2;
+            uint32_t ARPE : 1;
+            uint32_t CKD : 2;
+            uint32_t : 22;
+        } b;
+        Cr1(uint32_t r=0) : r(r) {}
+    } CR1;
+    union Dier {
+        uint32_t r;
+        struct {
+            uint32_t UIE : 1;
+            uint32_t CC1IE : 1;
+            uint32_t : 30;
+        } b;
+        Dier(uint32_t r=0) : r(r) {}
+    } DIER;
+    union Sr {
+        uint32_t r;
+        struct {
+            uint32_t UIF : 1;
+            uint32_t CC1IF : 1;
+            uint32_t : 30;
+        } b;
+        Sr(uint32_t r=0) : r(r) {}
+    } SR;
+    union Egr {
+        uint32_t r;
+        struct {
+            uint32_t UG : 1;
+            uint32_t CC1G : 1;
+            uint32_t : 30;
+        } b;
+        Egr(uint32_t r=0) : r(r) {}
+    } EGR;
+    struct {
+        uint32_t CNT = 0;
+    } CNT;
+    struct {
+        uint32_t PSC = 0;
+    } PSC;
+    struct {
+        uint32_t ARR = 0xffff;
+    } ARR;
+};
+
+extern Tim TIM16;
+
+inline Tim &TIM(size_t) {
+    return TIM16;
+}
+
+}
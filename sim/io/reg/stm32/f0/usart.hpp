@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "io/reg/stm32/f0/base.hpp"
+
+/** Universal synchronous asynchronous receiver transmitter
+(host simulator replacement of io register library)
+written data are passed to output callback instead of wire
+*/
+
+namespace io {
+
+struct Usart {
+    union Cr1 {
+        uint32_t r;
+        struct {
+            uint32_t UE : 1;
+            uint32_t UESM : 1;
+            uint32_t RE : 1;
+            uint32_t TE : 1;
+            uint32_t IDLEIE : 1;
+            uint32_t RXNEIE : 1;
+            uint32_t TCIE : 1;
+            uint32_t TXEIE : 1;
+            uint32_t : 24;
+        } b;
+        Cr1(uint32_t r=0) : r(r) {}
+    } CR1;
+    union Cr2 {
+        uint32_t r;
+        Cr2(uint32_t r=0) : r(r) {}
+    } CR2;
+    union Cr3 {
+        uint32_t r;
+        struct {
+            uint32_t EIE : 1;
+            uint32_t IREN : 1;
+            uint32_t IRLP : 1;
+            uint32_t HDSEL : 1;
+            uint32_t NACK : 1;
+            uint32_t SCEN : 1;
+            uint32_t DMAR : 1;
+            uint32_t DMAT : 1;
+            uint32_t : 24;
+        } b;
+        Cr3(uint32_t r=0) : r(r) {}
+    } CR3;
+    union Brr {
+        uint32_t r;
+        Brr(uint32_t r=0) : r(r) {}
+    } BRR;
+    union Isr {
+        uint32_t r;
+        struct {
+            uint32_t PE : 1;
+            uint32_t FE : 1;
+            uint32_t NF : 1;
+            uint32_t ORE : 1;
+            uint32_t IDLE : 1;
+            uint32_t RXNE : 1;
+            uint32_t TC : 1;
+            uint32_t TXE : 1;
+            uint32_t : 24;
+        } b;
+        Isr(uint32_t r=0) : r(r) {}
+    } ISR{0xc0};
+    union Icr {
+        uint32_t r;
+        struct {
+            uint32_t : 6;
+            uint32_t TCCF : 1;
+            uint32_t : 25;
+        } b;
+        Icr(uint32_t r=0) : r(r) {}
+    } ICR;
+    struct {
+        uint8_t DR = 0;
+    } RDR;
+    struct Tdr {
+        struct Data {
+            void (*output)(char) = nullptr;
+            Data &operator=(uint32_t data) {
+                if (output) output(data);
+                return *this;
+            }
+        } DR;
+    } TDR;
+};
+
+extern Usart USART1;
+
+inline Usart &USART(size_t) {
+    return USART1;
+}
+
+}
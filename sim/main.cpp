@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "simulation.hpp"
+
+static void usage(const char *name) {
+    printf("usage: %s [--option value ...] [--uart] [--trace] [--heater-measured] [--pid] [--autotune]\n", name);
+    printf("options:\n");
+    printf("  --setpoint C, --duration s, --loop-us us, --draw-us us, --band C,\n");
+    printf("  --noise lsb, --spikes probability, --open-at s, --open-time s,\n");
+    printf("  --ambient C, --capacity J/K,\n");
+    printf("  --rth K/W, --dead-time s,\n");
+    printf("  --rheater Ohm, --tc 1/K, --vsource V, --rsource Ohm, --vdd V,\n");
+    printf("  --dropout V, --cpu-capacitance F, --cpu-current A,\n");
+    printf("  --csv file\n");
+}
+
+int main(int argc, char *argv[]) {
+    Simulation::Config config;
+    sim::Plant::Config plant;
+    const struct {
+        const char *name;
+        double *value;
+    } options[] = {
+        {"--setpoint", &config.setpoint_c},
+        {"--duration", &config.duration_s},
+        {"--loop-us", &config.loop_us},
+        {"--draw-us", &config.draw_us},
+        {"--band", &config.band_c},
+        {"--noise", &config.adc_noise_lsb},
+        {"--spikes", &config.adc_spikes},
+        {"--open-at", &config.open_at_s},
+        {"--open-time", &config.open_time_s},
+        {"--ambient", &plant.ambient_c},
+        {"--capacity", &plant.heat_capacity_jk},
+        {"--rth", &plant.thermal_resistance_kw},
+        {"--dead-time", &plant.dead_time_s},
+        {"--rheater", &plant.heater_resistance_ohm},
+        {"--tc", &plant.heater_tc},
+        {"--vsource", &plant.source_voltage_v},
+        {"--rsource", &plant.source_resistance_ohm},
+        {"--vdd", &plant.cpu_voltage_v},
+        {"--dropout", &plant.regulator_dropout_v},
+        {"--cpu-capacitance", &plant.cpu_capacitance_f},
+        {"--cpu-current", &plant.cpu_current_a},
+    };
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--uart")) {
+            config.uart = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--trace")) {
+            config.trace = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--autotune")) {
+            config.autotune = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--pid")) {
+            config.controller = Heating::Controller::PID;
+            continue;
+        }
+        if (!strcmp(argv[i], "--heater-measured")) {
+            config.heater_control = Heating::HeaterControl::MEASURED;
+            continue;
+        }
+        if (!strcmp(argv[i], "--csv") && i + 1 < argc) {
+            config.csv = argv[++i];
+            continue;
+        }
+        bool found = false;
+        for (const auto &option : options) {
+            if (strcmp(argv[i], option.name) || i + 1 >= argc) continue;
+            *option.value = atof(argv[++i]);
+            found = true;
+        }
+        if (!found) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    Simulation simulation(config, plant);
+    simulation.run();
+    simulation.report();
+    if (config.csv && !simulation.write_csv(config.csv)) {
+        fprintf(stderr, "can not write %s\n", config.csv);
+        return 1;
+    }
+    return 0;
+}
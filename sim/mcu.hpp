@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include "io/reg/cortexm/nvic.hpp"
+#include "io/reg/cortexm/systick.hpp"
+#include "io/reg/stm32/f0/adc.hpp"
+#include "io/reg/stm32/f0/dma.hpp"
+#include "io/reg/stm32/f0/gpio.hpp"
+#include "io/reg/stm32/f0/syscfg.hpp"
+#include "io/reg/stm32/f0/sysmem.hpp"
+#include "io/reg/stm32/f0/tim.hpp"
+#include "io/reg/stm32/f0/usart.hpp"
+#include "board/clock.hpp"
+#include "board/adc.hpp"
+#include "plant.hpp"
+
+void SYSTICK_handler();
+void DMA1_CH1_handler();
+void ADC_handler();
+void TIM16_handler();
+void DMA1_CH4_5_handler();
+
+namespace sim {
+
+/** Virtual MCU
+
+Advance virtual time and emulate peripherals used by heating:
+systick, ADC with DMA transfer and its interrupt, analog watchdog, heater
+output pin, one pulse timer which switch heater off and USART transmit by DMA.
+Analog inputs are generated from plant model.
+*/
+class Mcu {
+public:
+    static const unsigned CORE_FREQ = board::Clock::CORE_FREQ;
+    // maximum integration step of plant
+    static const unsigned MAX_STEP_TICKS = CORE_FREQ / 10000;
+
+private:
+    // board wiring (see board/heater.hpp and board/adc.hpp)
+    static const unsigned HEATER_PIN = 3;
+    static const unsigned DMA_CH_ADC = 1;
+    static const unsigned ADC_CH_PEN_CURRENT = 0;
+    static const unsigned ADC_CH_PEN_TEMPERATURE = 1;
+    static const unsigned ADC_CH_SUPPLY_VOLTAGE = 3;
+    static const unsigned ADC_CH_CPU_TEMPERATURE = 16;
+    static const unsigned ADC_CH_CPU_REFERENCE = 17;
+    static const unsigned ADC_CHANNELS = 19;
+
+    Plant &_plant;
+    uint64_t _ticks = 0;
+
+    double _adc_noise_lsb = 0;
+    std::mt19937 _noise_generator{1};
+    std::normal_distribution<double> _noise{0.0, 1.0};
+    double _adc_spike_probability = 0;
+    std::uniform_real_distribution<double> _uniform{0.0, 1.0};
+
+    bool _thermocouple_open = false;
+
+    bool _adc_running = false;
+    unsigned _adc_channel = 0;
+    unsigned _adc_remaining_ticks = 0;
+
+    bool _timer_running = false;
+    uint64_t _timer_remaining_ticks = 0;
+
+    bool _uart_running = false;
+    unsigned _uart_remaining_ticks = 0;
+
+    struct DmaState {
+        uint32_t length = 0;
+        uint32_t ndt = 0;
+        size_t address = 0;
+    } _dma_adc, _dma_uart;
+
+    /** Duration of one channel conversion
+    ADC clock is PCLK / 4, each channel is sampling time + 12.5 cycles
+    */
+    unsigned _adc_channel_ticks() {
+        static const unsigned SAMPLING_HALF_CYCLES[] = {3, 15, 27, 57, 83, 111, 143, 479};
+        return 4 * (SAMPLING_HALF_CYCLES[io::ADC.SMPR.b.SMP] + 25) / 2;
+    }
+
+    unsigned _adc_next_channel(unsigned channel) {
+        while (channel < ADC_CHANNELS && !(io::ADC.CHSELR.r & (1u << channel))) channel++;
+        return channel;
+    }
+
+    /** Convert voltage on ADC input into left aligned 12 bit value */
+    uint16_t _adc_convert(double voltage, bool spikes=false) {
+        double value = voltage / _plant.get_cpu_voltage() * 4096;
+        if (_adc_noise_lsb > 0) value += _noise(_noise_generator) * _adc_noise_lsb;
+        if (spikes && _adc_spike_probability > 0 && _uniform(_noise_generator) < _adc_spike_probability) {
+            value = _uniform(_noise_generator) * 4096;
+        }
+        if (value < 0) value = 0;
+        if (value > 4095) value = 4095;
+        return static_cast<uint16_t>(value) << 4;
+    }
+
+    /** Voltage of type K thermocouple
+    (NIST ITS-90 reference function, 0 .. 1372 degree C, independent from
+    inverse polynomial used by firmware)
+
+    Arguments:
+        temperature_c: temperature of junction
+
+    Return:
+        voltage in mV
+    */
+    static double _thermocouple_emf(double temperature_c) {
+        static const double coefs[] = {
+            -1.7600413686e-2, 3.8921204975e-2, 1.8558770032e-5, -9.9457592874e-8, 3.1840945719e-10,
+            -5.6072844889e-13, 5.6075059059e-16, -3.2020720003e-19, 9.7151147152e-23, -1.2104721275e-26,
+        };
+        double emf = 0;
+        for (int i = sizeof(coefs) / sizeof(coefs[0]) - 1; i >= 0; i--) emf = emf * temperature_c + coefs[i];
+        return emf + 1.185976e-1 * exp(-1.183432e-4 * (temperature_c - 126.9686) * (temperature_c - 126.9686));
+    }
+
+    /** Voltage of amplified thermocouple
+
+    Arguments:
+        tip_c: temperature of tip
+        cold_c: temperature of cold junction
+
+    Return:
+        voltage on ADC input in V
+    */
+    static double _thermocouple_voltage(double tip_c, double cold_c) {
+        return (_thermocouple_emf(tip_c) - _thermocouple_emf(cold_c)) * board::Adc::PEN_AMPLIFIER_GAIN / 1000;
+    }
+
+    uint16_t _adc_sample(unsigned channel) {
+        bool heater_on = is_heater_on();
+        switch (channel) {
+        case ADC_CH_PEN_CURRENT:
+            // 110 mV / A, biased to half of VDD
+            return _adc_convert(_plant.get_cpu_voltage() / 2 + _plant.get_current(heater_on) * 0.110, true);
+        case ADC_CH_PEN_TEMPERATURE:
+            // open input is pulled to VDD
+            if (_thermocouple_open) return _adc_convert(_plant.get_cpu_voltage());
+            // amplified thermocouple
+            return _adc_convert(_thermocouple_voltage(_plant.get_sensor_temperature(), _plant.get_cpu_temperature()), true);
+        case ADC_CH_SUPPLY_VOLTAGE:
+            // divider with 68 and 10 kOhm
+            return _adc_convert(_plant.get_supply_voltage(heater_on) * 10 / (68 + 10));
+        case ADC_CH_CPU_TEMPERATURE: {
+            double cal30 = io::SYSMEM.TEMP30_CAL;
+            double cal110 = io::SYSMEM.TEMP110_CAL;
+            double cal = cal30 + (cal110 - cal30) * (_plant.get_cpu_temperature() - 30) / (110 - 30);
+            return _adc_convert(cal / 4096 * 3.3);
+        }
+        case ADC_CH_CPU_REFERENCE:
+            return _adc_convert(io::SYSMEM.VREFINT_CAL / 4096.0 * 3.3);
+        }
+        return 0;
+    }
+
+    void _dma_transfer(uint16_t value) {
+        io::Dma::Channel &channel = io::DMA1.CHANNEL(DMA_CH_ADC);
+        if (!channel.CCR.b.EN) return;
+        if (channel.CNDTR.NDT != _dma_adc.ndt || channel.CMAR.MAR != _dma_adc.address) {
+            // channel was re-armed by firmware
+            _dma_adc.length = channel.CNDTR.NDT;
+            _dma_adc.address = channel.CMAR.MAR;
+        }
+        if (!channel.CNDTR.NDT) return;
+        unsigned index = channel.CCR.b.MINC ? _dma_adc.length - channel.CNDTR.NDT : 0;
+        reinterpret_cast<uint16_t *>(_dma_adc.address)[index] = value;
+        channel.CNDTR.NDT--;
+        io::DMA1.ISR.r |= 1u << io::Dma::Isr::shift(DMA_CH_ADC);
+        if (channel.CNDTR.NDT == _dma_adc.length / 2) {
+            io::DMA1.ISR.r |= 4u << io::Dma::Isr::shift(DMA_CH_ADC);
+        }
+        if (channel.CNDTR.NDT == 0) {
+            io::DMA1.ISR.r |= 2u << io::Dma::Isr::shift(DMA_CH_ADC);
+            if (channel.CCR.b.CIRC) channel.CNDTR.NDT = _dma_adc.length;
+        }
+        _dma_adc.ndt = channel.CNDTR.NDT;
+        bool irq = channel.CCR.b.TCIE && io::DMA1.ISR.TCIF(DMA_CH_ADC);
+        irq |= channel.CCR.b.HTIE && io::DMA1.ISR.HTIF(DMA_CH_ADC);
+        if (irq && io::NVIC.is_enabled(io::isr::DMA1_CH1_isr)) DMA1_CH1_handler();
+    }
+
+    void _adc_start() {
+        if (_adc_running || !io::ADC.CR.b.ADSTART) return;
+        _adc_channel = _adc_next_channel(0);
+        if (_adc_channel >= ADC_CHANNELS) return;
+        io::ADC.ISR.b.EOSEQ = false;
+        _adc_running = true;
+        _adc_remaining_ticks = _adc_channel_ticks();
+    }
+
+    /** Analog watchdog compare raw 12 bit conversion with thresholds */
+    void _adc_watchdog(unsigned channel, uint16_t value) {
+        if (!io::ADC.CFGR1.b.AWDEN) return;
+        if (io::ADC.CFGR1.b.AWDSGL && io::ADC.CFGR1.b.AWDCH != channel) return;
+        unsigned raw = value >> 4;
+        if (raw <= io::ADC.TR.b.HT && raw >= io::ADC.TR.b.LT) return;
+        io::ADC.ISR.b.AWD = true;
+        if (io::ADC.IER.b.AWDIE && io::NVIC.is_enabled(io::isr::ADC_isr)) ADC_handler();
+    }
+
+    void _adc_end_of_conversion() {
+        uint16_t value = _adc_sample(_adc_channel);
+        io::ADC.DR.DATA = value;
+        _adc_watchdog(_adc_channel, value);
+        _adc_channel = _adc_next_channel(_adc_channel + 1);
+        if (_adc_channel >= ADC_CHANNELS && io::ADC.CFGR1.b.CONT) {
+            _adc_channel = _adc_next_channel(0);
+        }
+        if (_adc_channel < ADC_CHANNELS) {
+            _adc_remaining_ticks = _adc_channel_ticks();
+        } else {
+            // end of sequence (before DMA interrupt, which can start new one)
+            _adc_running = false;
+            io::ADC.CR.b.ADSTART = false;
+            io::ADC.ISR.b.EOSEQ = true;
+        }
+        _dma_transfer(value);
+    }
+
+    void _timer_start() {
+        if (!io::TIM16.CR1.b.CEN) {
+            _timer_running = false;
+            return;
+        }
+        if (_timer_running) return;
+        _timer_running = true;
+        _timer_remaining_ticks = (uint64_t)(io::TIM16.ARR.ARR + 1 - io::TIM16.CNT.CNT) * (io::TIM16.PSC.PSC + 1);
+    }
+
+    void _timer_update() {
+        _timer_running = false;
+        io::TIM16.CNT.CNT = 0;
+        if (io::TIM16.CR1.b.OPM) io::TIM16.CR1.b.CEN = false;
+        io::TIM16.SR.b.UIF = true;
+        if (io::TIM16.DIER.b.UIE && io::NVIC.is_enabled(io::isr::TIM16_isr)) TIM16_handler();
+    }
+
+    unsigned _dma_ch_uart_tx() {
+        return io::SYSCFG.CFGR1.b.USART1_TX_DMA_RMP ? 4 : 2;
+    }
+
+    /** Start DMA transfer of USART when channel is enabled
+    each byte takes 10 bits of time
+    */
+    void _uart_start() {
+        if (_uart_running || !io::USART1.CR3.b.DMAT) return;
+        io::Dma::Channel &channel = io::DMA1.CHANNEL(_dma_ch_uart_tx());
+        if (!channel.CCR.b.EN || !channel.CNDTR.NDT) return;
+        _dma_uart.length = channel.CNDTR.NDT;
+        _dma_uart.address = channel.CMAR.MAR;
+        _uart_running = true;
+        _uart_remaining_ticks = io::USART1.BRR.r * 10;
+    }
+
+    void _uart_end_of_byte() {
+        unsigned ch = _dma_ch_uart_tx();
+        io::Dma::Channel &channel = io::DMA1.CHANNEL(ch);
+        if (!channel.CCR.b.EN) {
+            _uart_running = false;
+            return;
+        }
+        io::USART1.TDR.DR = reinterpret_cast<uint8_t *>(_dma_uart.address)[_dma_uart.length - channel.CNDTR.NDT];
+        channel.CNDTR.NDT--;
+        if (channel.CNDTR.NDT) {
+            _uart_remaining_ticks = io::USART1.BRR.r * 10;
+            return;
+        }
+        _uart_running = false;
+        io::DMA1.ISR.r |= 3u << io::Dma::Isr::shift(ch);
+        if (channel.CCR.b.TCIE && io::NVIC.is_enabled(io::isr::DMA1_CH4_5_isr)) DMA1_CH4_5_handler();
+    }
+
+    void _systick_advance(unsigned ticks) {
+        uint64_t period = io::SYSTICK.LOAD.RELOAD + 1;
+        uint64_t wraps = (_ticks + ticks) / period - _ticks / period;
+        _ticks += ticks;
+        if (!io::SYSTICK.CSR.b.ENABLE) return;
+        io::SYSTICK.VAL.CURRENT = io::SYSTICK.LOAD.RELOAD - _ticks % period;
+        if (io::SYSTICK.CSR.b.TICKINT && io::Nvic::isr_enabled) {
+            while (wraps--) SYSTICK_handler();
+        }
+    }
+
+public:
+    Mcu(Plant &plant) : _plant(plant) {
+        io::ADC.ISR.b.ADRDY = true;
+    }
+
+    /** Set standard deviation of noise added to every ADC sample
+
+    Arguments:
+        lsb: noise in LSB of 12 bit conversion
+    */
+    void set_adc_noise(double lsb) {
+        _adc_noise_lsb = lsb;
+    }
+
+    /** Set probability of spike (random value on full scale) in sample
+    of pen current and thermocouple (long wires to tip)
+
+    Arguments:
+        probability: probability of spike in each sample 0 .. 1
+    */
+    void set_adc_spikes(double probability) {
+        _adc_spike_probability = probability;
+    }
+
+    /** Disconnect thermocouple (tip removed or bad contact)
+
+    Arguments:
+        open: true if thermocouple is disconnected
+    */
+    void set_thermocouple_open(bool open) {
+        _thermocouple_open = open;
+    }
+
+    /** Set callback for characters transmitted by USART1 */
+    void set_uart_output(void (*output)(char)) {
+        io::USART1.TDR.DR.output = output;
+    }
+
+    uint64_t get_ticks() const {
+        return _ticks;
+    }
+
+    double get_time() const {
+        return static_cast<double>(_ticks) / CORE_FREQ;
+    }
+
+    bool is_heater_on() const {
+        return io::GPIOB.ODR.get(HEATER_PIN);
+    }
+
+    /** Advance virtual time
+
+    Arguments:
+        ticks: number of CPU ticks (time spent by firmware)
+    */
+    void advance(unsigned ticks) {
+        while (ticks) {
+            _adc_start();
+            _timer_start();
+            _uart_start();
+            unsigned step = ticks;
+            if (step > MAX_STEP_TICKS) step = MAX_STEP_TICKS;
+            if (_adc_running && step > _adc_remaining_ticks) step = _adc_remaining_ticks;
+            if (_timer_running && step > _timer_remaining_ticks) step = _timer_remaining_ticks;
+            if (_uart_running && step > _uart_remaining_ticks) step = _uart_remaining_ticks;
+            _plant.step(static_cast<double>(step) / CORE_FREQ, is_heater_on());
+            _systick_advance(step);
+            ticks -= step;
+            if (_timer_running) {
+                _timer_remaining_ticks -= step;
+                if (!_timer_remaining_ticks) _timer_update();
+            }
+            if (_uart_running) {
+                _uart_remaining_ticks -= step;
+                if (!_uart_remaining_ticks) _uart_end_of_byte();
+            }
+            if (!_adc_running) continue;
+            _adc_remaining_ticks -= step;
+            if (!_adc_remaining_ticks) _adc_end_of_conversion();
+        }
+    }
+};
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cmath>
+#include <deque>
+#include <utility>
+
+namespace sim {
+
+/** Thermal and electrical model of RT tip with its power supply
+
+First order thermal model (heat capacity of tip and thermal resistance
+to ambient) with transport delay between heater and thermocouple
+(dead time). Heater is resistive element supplied from voltage source
+with internal resistance, CPU regulator has output capacitor, which supply
+CPU while input voltage is below regulation. All values are in SI units
+(s, V, A, F, Ohm, W, J).
+*/
+class Plant {
+public:
+    struct Config {
+        double ambient_c = 25.0;  // degree C
+        double heat_capacity_jk = 1.2;  // J/K
+        double thermal_resistance_kw = 70.0;  // K/W (loss to ambient)
+        double dead_time_s = 0.2;  // s (heater to thermocouple)
+        double heater_resistance_ohm = 2.0;  // Ohm at 20 degree C
+        double heater_tc = 0.0;  // 1/K (temperature coefficient of heater)
+        double source_voltage_v = 12.0;  // V (open circuit voltage of supply)
+        double source_resistance_ohm = 0.2;  // Ohm (supply + cable)
+        double cpu_voltage_v = 3.3;  // V (output of regulator)
+        double regulator_dropout_v = 0.3;  // V (CPU voltage follows supply below regulation)
+        double cpu_capacitance_f = 4.7e-6;  // F (output capacitor of regulator)
+        double cpu_current_a = 0.01;  // A (CPU and display)
+    };
+
+private:
+    Config _config;
+    double _time = 0;
+    double _tip_temperature = 0;
+    double _energy = 0;
+    double _supply_voltage_min;  // V, lowest supply voltage during heating
+    double _cpu_voltage;  // V, voltage of regulator output capacitor
+    double _cpu_voltage_min;  // V, lowest CPU voltage
+    std::deque<std::pair<double, double>> _history;  // (time, tip temperature)
+
+public:
+    Plant(const Config &config) :
+        _config(config),
+        _tip_temperature(config.ambient_c),
+        _supply_voltage_min(config.source_voltage_v),
+        _cpu_voltage(config.cpu_voltage_v),
+        _cpu_voltage_min(config.cpu_voltage_v) {
+        _history.emplace_back(_time, _tip_temperature);
+    }
+
+    const Config &get_config() const {
+        return _config;
+    }
+
+    /** Integrate model over time step with constant heater state
+
+    Arguments:
+        dt: time step in s
+        heater_on: state of heater switch
+    */
+    void step(double dt, bool heater_on) {
+        double power = get_heater_power(heater_on);
+        double tau = _config.heat_capacity_jk * _config.thermal_resistance_kw;
+        double final_temperature = _config.ambient_c + power * _config.thermal_resistance_kw;
+        _tip_temperature = final_temperature + (_tip_temperature - final_temperature) * std::exp(-dt / tau);
+        _energy += power * dt;
+        if (heater_on && get_supply_voltage(true) < _supply_voltage_min) _supply_voltage_min = get_supply_voltage(true);
+        // regulator charge capacitor immediately, it is discharged by CPU
+        // when regulator input is too low
+        double regulated = get_supply_voltage(heater_on) - _config.regulator_dropout_v;
+        if (regulated > _config.cpu_voltage_v) regulated = _config.cpu_voltage_v;
+        double discharged = _config.cpu_capacitance_f > 0 ? _cpu_voltage - _config.cpu_current_a / _config.cpu_capacitance_f * dt : regulated;
+        _cpu_voltage = regulated > discharged ? regulated : discharged;
+        if (_cpu_voltage < _cpu_voltage_min) _cpu_voltage_min = _cpu_voltage;
+        _time += dt;
+        _history.emplace_back(_time, _tip_temperature);
+        while (_history.size() > 2 && _history[1].first <= _time - _config.dead_time_s) {
+            _history.pop_front();
+        }
+    }
+
+    double get_time() const {
+        return _time;
+    }
+
+    /** Real temperature of heater in tip */
+    double get_tip_temperature() const {
+        return _tip_temperature;
+    }
+
+    /** Temperature seen by thermocouple (delayed by dead time) */
+    double get_sensor_temperature() const {
+        double time = _time - _config.dead_time_s;
+        if (_history.size() < 2 || time <= _history[0].first) return _history[0].second;
+        const auto &a = _history[0];
+        const auto &b = _history[1];
+        if (time >= b.first) return b.second;
+        return a.second + (b.second - a.second) * (time - a.first) / (b.first - a.first);
+    }
+
+    double get_heater_resistance() const {
+        return _config.heater_resistance_ohm * (1 + _config.heater_tc * (_tip_temperature - 20));
+    }
+
+    double get_current(bool heater_on) const {
+        if (!heater_on) return 0;
+        return _config.source_voltage_v / (_config.source_resistance_ohm + get_heater_resistance());
+    }
+
+    double get_supply_voltage(bool heater_on) const {
+        return _config.source_voltage_v - get_current(heater_on) * _config.source_resistance_ohm;
+    }
+
+    double get_heater_power(bool heater_on) const {
+        double current = get_current(heater_on);
+        return current * current * get_heater_resistance();
+    }
+
+    double get_cpu_voltage() const {
+        return _cpu_voltage;
+    }
+
+    double get_cpu_temperature() const {
+        return _config.ambient_c;
+    }
+
+    /** Lowest supply voltage during heating in V */
+    double get_supply_voltage_min() const {
+        return _supply_voltage_min;
+    }
+
+    /** Lowest CPU voltage in V */
+    double get_cpu_voltage_min() const {
+        return _cpu_voltage_min;
+    }
+
+    /** Energy delivered into heater in J */
+    double get_energy() const {
+        return _energy;
+    }
+};
+
+}
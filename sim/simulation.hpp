@@ -0,0 +1,312 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "board/systick.hpp"
+#include "board/heater.hpp"
+#include "board/debug.hpp"
+#include "board/adc.hpp"
+#include "heating.hpp"
+#include "plant.hpp"
+#include "mcu.hpp"
+
+/** Host simulator of heating control loop
+
+Real Heating state machine and PID are running against virtual MCU
+with thermal model of RT tip, in virtual time.
+Result is step response of tip temperature from ambient to preset.
+
+With Config::timing is measured host time of Heating calls done by main
+loop (used by benchmark).
+*/
+class Simulation {
+public:
+    struct Config {
+        double setpoint_c = 300;  // degree C
+        double duration_s = 20;  // s
+        double loop_us = 50;  // time of one main loop iteration
+        double draw_us = 4000;  // time of display drawing (once per period)
+        double band_c = 5;  // settling band
+        double adc_noise_lsb = 0;
+        double adc_spikes = 0;  // probability of spike in ADC sample
+        double open_at_s = -1;  // s, thermocouple is disconnected from this time
+        double open_time_s = 0;  // s, for this time
+        const char *csv = nullptr;
+        bool uart = false;
+        bool trace = false;
+        bool autotune = false;
+        bool timing = false;
+        Heating::HeaterControl heater_control = Heating::HeaterControl::TIMED;
+        Heating::Controller controller = Heating::Controller::FIXED_PID;
+    };
+
+    struct Sample {
+        double time;
+        double tip_c;
+        double sensor_c;
+        double reported_c;
+        double predicted_c;
+        int requested_power_mw;
+        int power_mw;
+        int supply_mv;
+    };
+
+    /** Host time of firmware calls, without overhead of clock */
+    struct Timing {
+        double heating_ns = 0;  // Heating::process() and start()
+        long periods = 0;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Config _config;
+    Timing _timing;
+    sim::Plant _plant;
+    sim::Mcu _mcu;
+    Heating _heating;
+    std::vector<Sample> _samples;
+    bool _thermocouple_open = false;
+    bool _reconnected = false;  // thermocouple was connected, preset is not selected yet
+
+    static void _uart_output(char ch) {
+        fputc(ch, stderr);
+    }
+
+    unsigned _us2ticks(double us) {
+        return us * sim::Mcu::CORE_FREQ / 1000000;
+    }
+
+    /** Start relay autotune when tip is identified, print result when it finish */
+    void _autotune() {
+        const lib::RelayTuner &tuner = _heating.get_autotune();
+        if (tuner.get_state() == lib::RelayTuner::State::IDLE) {
+            if (_heating.autotune_start()) printf("autotune started:  %8.3f s\n", _mcu.get_time());
+            return;
+        }
+        if (tuner.is_running()) return;
+        _config.autotune = false;
+        if (tuner.get_state() == lib::RelayTuner::State::FAILED) {
+            printf("autotune failed:   %8.3f s\n", _mcu.get_time());
+            return;
+        }
+        int p, i, d;
+        tuner.get_gains(p, i, d);
+        printf("autotune done:     %8.3f s\n", _mcu.get_time());
+        printf("ultimate gain:     %8d mW/C\n", tuner.get_ultimate_gain());
+        printf("ultimate period:   %8d ms\n", tuner.get_ultimate_period_ms());
+        printf("gains P, I, D:     %d, %d, %d\n", p, i, d);
+    }
+
+    void _set_preset() {
+        Preset &preset = _heating.get_preset();
+        preset.edit_select(0);
+        preset.edit_add(_config.setpoint_c * 1000 - preset.get_preset(0));
+        preset.edit_end();
+        preset.select(0);
+    }
+
+    void _record() {
+        _samples.push_back({
+            _mcu.get_time(),
+            _plant.get_tip_temperature(),
+            _plant.get_sensor_temperature(),
+            _heating.get_real_pen_temperature_mc() / 1000.0,
+            _heating.get_predicted_pen_temperature_mc() / 1000.0,
+            _heating.get_requested_power_mw(),
+            _heating.get_power_mw(),
+            _heating.get_supply_voltage_mv_idle(),
+        });
+    }
+
+    /** RMS of difference between model prediction (made without last
+    measurement) and measurement, over whole simulation */
+    double _prediction_rms() const {
+        double sum = 0;
+        int count = 0;
+        for (const auto &s : _samples) {
+            double difference = s.predicted_c - s.reported_c;
+            sum += difference * difference;
+            count++;
+        }
+        return count ? sqrt(sum / count) : 0;
+    }
+
+    /** Measure time of function, empty section measured just before it
+    (in same state of caches) is subtracted as overhead of clock */
+    template <class F>
+    void _measure(double &ns, F function) {
+        auto t0 = Clock::now();
+        auto t1 = Clock::now();
+        function();
+        auto t2 = Clock::now();
+        ns += std::chrono::duration<double, std::nano>((t2 - t1) - (t1 - t0)).count();
+    }
+
+    bool _process(unsigned delta_ticks) {
+        if (!_config.timing) return _heating.process(delta_ticks);
+        bool heating = false;
+        _measure(_timing.heating_ns, [&] { heating = _heating.process(delta_ticks); });
+        return heating;
+    }
+
+    void _start() {
+        if (!_config.timing) {
+            _heating.start();
+            return;
+        }
+        _measure(_timing.heating_ns, [&] { _heating.start(); });
+        _timing.periods++;
+    }
+
+    /** Number of used tip profiles (each identification of unknown resistance create one) */
+    int _tip_profiles() const {
+        const Tips &tips = _heating.get_tips();
+        int count = 0;
+        for (int i = 0; i < Tips::PROFILES; i++) {
+            if (tips.get_profile(i).resistance_mo) count++;
+        }
+        return count;
+    }
+
+public:
+    Simulation(const Config &config, const sim::Plant::Config &plant_config) :
+        _config(config),
+        _plant(plant_config),
+        _mcu(_plant) {}
+
+    /** Run main loop same way as MainClass::run */
+    void run() {
+        _mcu.set_adc_noise(_config.adc_noise_lsb);
+        _mcu.set_adc_spikes(_config.adc_spikes);
+        if (_config.uart) _mcu.set_uart_output(_uart_output);
+        board::systick.init_hw();
+        board::debug.init_hw();
+        board::heater.init_hw();
+        board::adc.init_hw();
+        io::Nvic::isr_enable();
+
+        trace.enable(_config.trace);
+        _heating.init(_config.controller);
+        _heating.set_heater_control(_config.heater_control);
+        _set_preset();
+        _start();
+
+        unsigned loop_ticks = _us2ticks(_config.loop_us);
+        unsigned draw_ticks = _us2ticks(_config.draw_us);
+        uint64_t end_ticks = _config.duration_s * sim::Mcu::CORE_FREQ;
+        unsigned last_ticks = board::systick.get_counter();
+        unsigned profiler_ticks = 0;
+        while (_mcu.get_ticks() < end_ticks) {
+            double time = _mcu.get_time();
+            bool open = time >= _config.open_at_s && time < _config.open_at_s + _config.open_time_s;
+            // user leave standby after tip is connected again
+            if (!open && _thermocouple_open) _reconnected = true;
+            if (_reconnected && _heating.getPenSensorStatus() == Heating::PenSensorStatus::OK) {
+                _heating.get_preset().select(0);
+                _reconnected = false;
+            }
+            _thermocouple_open = open;
+            _mcu.set_thermocouple_open(open);
+            _mcu.advance(loop_ticks);
+            unsigned delta_ticks = last_ticks;
+            last_ticks = board::systick.get_counter();
+            delta_ticks = ((1 << board::Systick::DIV_BITS) - 1) & (delta_ticks - last_ticks);
+            trace.drain(delta_ticks);
+            profiler_ticks += delta_ticks;
+            if (profiler_ticks >= sim::Mcu::CORE_FREQ) {
+                profiler_ticks -= sim::Mcu::CORE_FREQ;
+                profiler.send(delta_ticks);
+            }
+            if (_process(delta_ticks)) continue;
+            _record();
+            if (_config.autotune) _autotune();
+            _mcu.advance(draw_ticks);
+            _start();
+        }
+    }
+
+    const Timing &get_timing() const {
+        return _timing;
+    }
+
+    const sim::Plant &get_plant() const {
+        return _plant;
+    }
+
+    Heating &get_heating() {
+        return _heating;
+    }
+
+    bool write_csv(const char *file_name) const {
+        FILE *f = fopen(file_name, "w");
+        if (!f) return false;
+        fprintf(f, "time_s,tip_c,sensor_c,reported_c,predicted_c,requested_power_mw,power_mw,supply_mv\n");
+        for (const auto &s : _samples) {
+            fprintf(f, "%.4f,%.2f,%.2f,%.3f,%.3f,%d,%d,%d\n",
+                s.time, s.tip_c, s.sensor_c, s.reported_c, s.predicted_c, s.requested_power_mw, s.power_mw, s.supply_mv);
+        }
+        fclose(f);
+        return true;
+    }
+
+    /** Print step response metrics computed from real tip temperature */
+    void report() const {
+        if (_samples.empty()) return;
+        double start = _plant.get_config().ambient_c;
+        double target = _config.setpoint_c;
+        double step = target - start;
+        double t10 = -1, t90 = -1, settled = 0, peak = start;
+        bool in_band = false;
+        for (const auto &s : _samples) {
+            double progress = (s.tip_c - start) / step;
+            if (t10 < 0 && progress >= 0.1) t10 = s.time;
+            if (t90 < 0 && progress >= 0.9) t90 = s.time;
+            if (s.tip_c > peak) peak = s.tip_c;
+            bool inside = s.tip_c > target - _config.band_c && s.tip_c < target + _config.band_c;
+            if (inside && !in_band) settled = s.time;
+            in_band = inside;
+        }
+        // steady state statistics over last quarter of simulation
+        double tail = _samples.back().time * 3 / 4;
+        double sum_error = 0, sum_reported = 0, sum_predicted = 0, min = 1e9, max = -1e9, sum_power = 0;
+        int count = 0;
+        for (const auto &s : _samples) {
+            if (s.time < tail) continue;
+            sum_error += s.tip_c - target;
+            sum_reported += s.reported_c - s.tip_c;
+            sum_predicted += s.predicted_c - s.tip_c;
+            sum_power += s.power_mw;
+            if (s.tip_c < min) min = s.tip_c;
+            if (s.tip_c > max) max = s.tip_c;
+            count++;
+        }
+        printf("setpoint:          %8.1f C\n", target);
+        printf("rise time 10-90%%:  %8.3f s\n", (t10 >= 0 && t90 >= 0) ? t90 - t10 : -1.0);
+        printf("overshoot:         %8.2f C\n", peak > target ? peak - target : 0.0);
+        if (in_band) {
+            printf("settling (+-%.0fC): %8.3f s\n", _config.band_c, settled);
+        } else {
+            printf("settling (+-%.0fC):  not settled\n", _config.band_c);
+        }
+        printf("steady error:      %8.2f C\n", sum_error / count);
+        printf("steady ripple:     %8.2f C\n", max - min);
+        printf("sensor error:      %8.2f C\n", sum_reported / count);
+        printf("prediction error:  %8.2f C\n", sum_predicted / count);
+        printf("prediction rms:    %8.2f C\n", _prediction_rms());
+        printf("steady power:      %8.0f mW\n", sum_power / count);
+        printf("energy:            %8.1f J\n", _plant.get_energy());
+        printf("supply min:        %8.2f V\n", _plant.get_supply_voltage_min());
+        printf("supply resistance: %8d mOhm\n", _heating.get_supply_resistance_mo());
+        printf("power limit:       %8d mW\n", _heating.get_power_limit_mw());
+        printf("cpu voltage min:   %8.2f V\n", _plant.get_cpu_voltage_min());
+        printf("brownout limit:    %8d mV\n", _heating.get_brownout().get_limit_mv());
+        printf("brownout cuts:     %8u\n", _heating.get_brownout().get_cuts());
+        printf("supply insufficient: %6s\n", _heating.get_brownout().is_supply_insufficient() ? "yes" : "no");
+        printf("active tip:        %8d\n", _heating.get_tips().get_active_index());
+        printf("tip profiles:      %8d\n", _tip_profiles());
+        printf("periods:           %8zu\n", _samples.size());
+    }
+};
@@ -5,3 +5,11 @@ namespace board {
 Adc adc;
 
 }
+
+void DMA1_CH1_handler() {
+    board::adc.handler();
+}
+
+void ADC_handler() {
+    board::adc.watchdog_handler();
+}
@@ -6,10 +6,14 @@
 #include "io/reg/stm32/f0/dma.hpp"
 #include "io/reg/stm32/f0/sysmem.hpp"
 #include "board/gpio.hpp"
+#include "lib/linear_table.hpp"
 
 namespace board {
 
 class Adc {
+public:
+    static const int PEN_GAIN_Q = 16;  // fractional bits of tip calibration gain
+
 private:
     static const unsigned DMA_CH_ADC = 1;
 
@@ -21,41 +25,105 @@ private:
     GpioPin<io::base::GPIOA, 1> pen_temperature_input;
     GpioPin<io::base::GPIOA, 3> supply_voltage_input;
 
-    volatile uint16_t measured[5];
+    static const int CHANNELS = 5;
+    static const int OVERSAMPLING_BITS = 2;
+    static const int OVERSAMPLING = 1 << OVERSAMPLING_BITS;  // scans cumulated into one measurement
+
+    static const int INDEX_PEN_CURRENT = 0;
+    static const int INDEX_PEN_TEMPERATURE = 1;
+    static const int INDEX_SUPPLY_VOLTAGE = 2;
+    static const int INDEX_CPU_TEMPERATURE = 3;
+    static const int INDEX_CPU_REFERENCE = 4;
+
+public:
+    /** Duration of one measurement (half of DMA buffer) in CPU ticks,
+    each conversion takes 28.5 + 12.5 cycles of ADC clock (PCLK / 4)
+    */
+    static const unsigned MEASURE_TICKS = OVERSAMPLING * CHANNELS * (57 + 25) / 2 * 4;
+
+private:
+
+    // two halves of circular DMA buffer, one is filled while other is processed
+    volatile uint16_t dma_buffer[2][OVERSAMPLING][CHANNELS];
+    uint16_t measured[CHANNELS];
 
-    void start_dma_measure(const int count) {
-        // Configure DMA for ADC
+    void start_dma_scan() {
+        // Configure DMA for ADC in circular mode
         r_dma.IFCR.clear_flags(DMA_CH_ADC);
         r_dma_adc.CCR.r = 0x00000000;
-        r_dma_adc.CMAR.MAR = reinterpret_cast<size_t>(&measured);
+        r_dma_adc.CMAR.MAR = reinterpret_cast<size_t>(&dma_buffer);
         r_dma_adc.CPAR.PAR = reinterpret_cast<size_t>(&r_adc.DR.DATA);
-        r_dma_adc.CNDTR.NDT = count;
+        r_dma_adc.CNDTR.NDT = sizeof(dma_buffer) / sizeof(dma_buffer[0][0][0]);
         io::Dma::Channel::Ccr dma_adc_ccr(0x00000000);
         dma_adc_ccr.b.EN = true;
+        // half and transfer complete interrupts are enabled by measure_start()
+        dma_adc_ccr.b.CIRC = true;
         dma_adc_ccr.b.MINC = true;
         dma_adc_ccr.b.PSIZE = io::Dma::Channel::Ccr::Size::SIZE_16;
         dma_adc_ccr.b.MSIZE = io::Dma::Channel::Ccr::Size::SIZE_16;
         dma_adc_ccr.b.PL = io::Dma::Channel::Ccr::Pl::LOW;
         r_dma_adc.CCR.r = dma_adc_ccr.r;
-        // start ADC
+        // start continuous conversion
+        io::Adc::Chselr chselr(0x00000000);
+        chselr.b.CHSEL0 = true;  // pen_current
+        chselr.b.CHSEL1 = true;  // pen_temperature
+        chselr.b.CHSEL3 = true;  // supply_voltage
+        chselr.b.CHSEL16 = true;  // cpu_temperature
+        chselr.b.CHSEL17 = true;  // cpu_reference
+        r_adc.CHSELR.r = chselr.r;
         r_adc.CR.b.ADSTART = true;
     }
 
+    /** Cumulate scans from one half of DMA buffer
+
+    Arguments:
+        half: index of finished half of DMA buffer
+    */
+    void cumulate(const int half) {
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            unsigned sum = 0;
+            for (int i = 0; i < OVERSAMPLING; i++) {
+                sum += dma_buffer[half][i][ch];
+            }
+            // keep 16 bit scale, extra bits of resolution goes to low nibble
+            measured[ch] = sum >> OVERSAMPLING_BITS;
+        }
+    }
+
     enum class MeasureMode {
         NONE,
         IDLE,
         HEAT,
-    } measure_mode = MeasureMode::NONE;
-
-    static const int INDEX_HEAT_PEN_CURRENT = 0;
-    static const int INDEX_HEAT_SUPPLY_VOLTAGE = 1;
-    static const int INDEX_HEAT_CPU_REFERENCE = 2;
+    };
+    volatile MeasureMode measure_mode = MeasureMode::NONE;
+    volatile bool measure_armed = false;  // waiting for measurement
+    volatile int measure_skip = 0;  // blocks to drop (started before mode change, settling)
+    volatile bool measure_done = false;
+
+    /** Enable interrupts of DMA blocks
+    While no measurement is requested, DMA interrupts are masked, so
+    continuous scan (needed by analog watchdog) does not wake up CPU.
+
+    Arguments:
+        enable: true to process finished blocks
+    */
+    void measure_irq(const bool enable) {
+        io::Dma::Channel::Ccr dma_adc_ccr(r_dma_adc.CCR.r);
+        dma_adc_ccr.b.TCIE = enable;
+        dma_adc_ccr.b.HTIE = enable;
+        r_dma_adc.CCR.r = dma_adc_ccr.r;
+    }
 
-    static const int INDEX_IDLE_PEN_CURRENT = 0;
-    static const int INDEX_IDLE_PEN_TEMPERATURE = 1;
-    static const int INDEX_IDLE_SUPPLY_VOLTAGE = 2;
-    static const int INDEX_IDLE_CPU_TEMPERATURE = 3;
-    static const int INDEX_IDLE_CPU_REFERENCE = 4;
+    void measure_start(const MeasureMode mode, const int settle) {
+        measure_done = false;
+        measure_skip = (mode != measure_mode) + settle;
+        measure_mode = mode;
+        if (measure_armed) return;
+        measure_armed = true;
+        // blocks finished while interrupts were masked are older than request
+        r_dma.IFCR.clear_flags(DMA_CH_ADC);
+        measure_irq(true);
+    }
 
     static const uint16_t MAX_VALUE = 0xfff0;
 
@@ -70,30 +138,80 @@ private:
     int actual_pen_current = 0;
     bool pen_sensor_ok = false;
 
+    // calibration of inserted tip
+    int pen_temperature_offset = 0;  // 1/1000 degree C
+    int32_t pen_temperature_gain = (int32_t)1 << PEN_GAIN_Q;
+
+    static const int CALIBRATION_Q = 32;  // fractional bits of conversion coefficients
+    static const int PEN_VOLTAGE_SCALE = 16;  // pen thermocouple voltage in 1/16 mV
+    static const int RECIPROCAL_ITERATIONS = 2;
+
+    /** Conversion coefficients, computed once from factory calibration
+    so conversion of each sample use only multiplication and shift
+    (coefficients are in Q32 and multiplies measured value * CPU voltage)
+    */
+    struct Calibration {
+        uint32_t cpu_reference;  // VREFINT_CAL * 3300 mV (left aligned)
+        int32_t cpu_temperature_q;  // 1/1000 degree C
+        int32_t cpu_temperature_offset;  // 1/1000 degree C
+        int32_t supply_voltage_q;  // mV
+        int32_t pen_voltage_q;  // 1/PEN_VOLTAGE_SCALE mV
+        int32_t pen_current_q;  // mA
+    } calibration;
+
+    // reciprocal of measured reference in Q32, also initial guess for next conversion
+    uint32_t cpu_reference_reciprocal = 0;
+
+    void init_calibration() {
+        const int64_t one = (int64_t)1 << CALIBRATION_Q;
+        int vrefint = io::SYSMEM.VREFINT_CAL << 4;
+        int temp30 = io::SYSMEM.TEMP30_CAL << 4;
+        int temp110 = io::SYSMEM.TEMP110_CAL << 4;
+        calibration.cpu_reference = vrefint * 3300;
+        cpu_reference_reciprocal = one / vrefint;
+        calibration.cpu_temperature_q = one * (110 * 1000 - 30 * 1000) / 3300 / (temp110 - temp30);
+        calibration.cpu_temperature_offset = 30 * 1000 - (int64_t)temp30 * (110 * 1000 - 30 * 1000) / (temp110 - temp30);
+        calibration.supply_voltage_q = one * (68 + 10) / 10 / MAX_VALUE;  // divider with 68 and 10 kOhm
+        calibration.pen_voltage_q = one * PEN_VOLTAGE_SCALE / MAX_VALUE;
+        calibration.pen_current_q = one * 1000 / 110 / MAX_VALUE;  // 110 mV / A
+    }
+
+    /** Apply conversion coefficient
+
+    Arguments:
+        value: measured value
+        coef_q: conversion coefficient in Q32
+
+    Return:
+        value * CPU voltage * coefficient
+    */
+    int convert(const int value, const int32_t coef_q) {
+        return ((int64_t)value * actual_cpu_voltage * coef_q) >> CALIBRATION_Q;
+    }
+
     void calculate_cpu_voltage(const int index) {
-        int tmp = (io::SYSMEM.VREFINT_CAL << 4) * 3300;
-        tmp /= get_measured(index);
-        actual_cpu_voltage = tmp;
+        uint32_t measured_reference = get_measured(index);
+        if (!measured_reference) return;
+        // reciprocal by Newton-Raphson iterations: y = y * (2 - m * y)
+        uint64_t reciprocal = cpu_reference_reciprocal;
+        // iteration converge only for m * y < 2
+        while (measured_reference * reciprocal >= ((uint64_t)2 << CALIBRATION_Q)) reciprocal >>= 1;
+        for (int i = 0; i < RECIPROCAL_ITERATIONS; i++) {
+            uint64_t error = ((uint64_t)2 << CALIBRATION_Q) - measured_reference * reciprocal;
+            reciprocal = (reciprocal * error) >> CALIBRATION_Q;
+        }
+        cpu_reference_reciprocal = reciprocal;
+        actual_cpu_voltage = ((uint64_t)calibration.cpu_reference * reciprocal) >> CALIBRATION_Q;
     }
 
     void calculate_cpu_temperature(const int index) {
-        int tmp = get_measured(index);
-        tmp *= actual_cpu_voltage;
-        tmp /= 3300;
-        tmp -= (io::SYSMEM.TEMP30_CAL << 4);
-        tmp *= 110 * 1000 - 30 * 1000;
-        tmp /= (io::SYSMEM.TEMP110_CAL << 4) - (io::SYSMEM.TEMP30_CAL << 4);
-        tmp += 30 * 1000;
+        int tmp = convert(get_measured(index), calibration.cpu_temperature_q);
+        tmp += calibration.cpu_temperature_offset;
         actual_cpu_temperature = tmp;
     }
 
     void calculate_supply_voltage(const int index) {
-        int tmp = get_measured(index);
-        tmp *= actual_cpu_voltage;
-        tmp /= MAX_VALUE;
-        tmp *= 68 + 10;  // divider with 68 and 10 kOhm
-        tmp /= 10;
-        actual_supply_voltage = tmp;
+        actual_supply_voltage = convert(get_measured(index), calibration.supply_voltage_q);
     }
 
     void calculate_pen_temperature(const int index) {
@@ -103,40 +221,100 @@ private:
             actual_pen_temperature = 0;
             return;
         }
-        tmp *= actual_cpu_voltage;
-        tmp /= MAX_VALUE;
-        tmp *= 500 * 1000;  // 500 degrees at 3mV
-        tmp /= 3000;
-        actual_pen_temperature = tmp;
+        // thermocouple voltage is difference of tip and cold junction voltage,
+        // so cold junction voltage is added before linearisation
+        tmp = convert(tmp, calibration.pen_voltage_q) + pen_cold_junction_table.lookup(actual_cpu_temperature);
+        tmp = pen_temperature_table.lookup(tmp) - actual_cpu_temperature;
+        actual_pen_temperature = (((int64_t)tmp * pen_temperature_gain) >> PEN_GAIN_Q) + pen_temperature_offset;
     }
 
     void calculate_pen_current(const int index) {
         int tmp = get_measured(index);
         tmp -= MAX_VALUE / 2;
-        tmp *= actual_cpu_voltage;
-        tmp /= MAX_VALUE;
-        tmp *= 1000;  // mA
-        tmp /= 110;  // 110 mV / A
+        tmp = convert(tmp, calibration.pen_current_q);
         if (tmp < 0) tmp = -tmp;
         actual_pen_current = tmp;
     }
 
     void calculate_idle() {
-        calculate_cpu_voltage(INDEX_IDLE_CPU_REFERENCE);
-        calculate_cpu_temperature(INDEX_IDLE_CPU_TEMPERATURE);
-        calculate_supply_voltage(INDEX_IDLE_SUPPLY_VOLTAGE);
-        calculate_pen_temperature(INDEX_IDLE_PEN_TEMPERATURE);
-        calculate_pen_current(INDEX_IDLE_PEN_CURRENT);
+        calculate_cpu_voltage(INDEX_CPU_REFERENCE);
+        calculate_cpu_temperature(INDEX_CPU_TEMPERATURE);
+        calculate_supply_voltage(INDEX_SUPPLY_VOLTAGE);
+        calculate_pen_temperature(INDEX_PEN_TEMPERATURE);
+        calculate_pen_current(INDEX_PEN_CURRENT);
     }
 
     void calculate_heat() {
-        calculate_cpu_voltage(INDEX_HEAT_CPU_REFERENCE);
-        calculate_supply_voltage(INDEX_HEAT_SUPPLY_VOLTAGE);
-        calculate_pen_current(INDEX_HEAT_PEN_CURRENT);
+        calculate_cpu_voltage(INDEX_CPU_REFERENCE);
+        calculate_supply_voltage(INDEX_SUPPLY_VOLTAGE);
+        calculate_pen_current(INDEX_PEN_CURRENT);
     }
 
 public:
 
+    /** Characteristic of thermocouple of RT tip
+
+    Thermocouple is taken as type K: reference inverse polynomial (NIST
+    ITS-90, 0 .. 500 degree C, 0 .. 20.644 mV) gives temperature
+    difference between tip and cold junction in degree C from thermocouple
+    voltage in mV (coefficients from constant term). Differences of tips
+    are corrected by tip calibration.
+    */
+    static constexpr double PEN_TEMPERATURE_POLYNOMIAL[] = {
+        0, 2.508355e1, 7.860106e-2, -2.503131e-1, 8.315270e-2,
+        -1.228034e-2, 9.804036e-4, -4.413030e-5, 1.057734e-6, -1.052755e-8,
+    };
+
+    /** Gain of thermocouple amplifier, 500 degree C (20.644 mV) give 3 V on
+    ADC input, same end point as previous linear conversion, which is 4
+    degree C lower in middle of range
+    */
+    static constexpr double PEN_AMPLIFIER_GAIN = 3000 / 20.644;
+
+    /** Voltage of type K thermocouple in mV from temperature in degree C
+    for cold junction compensation (cubic fit of NIST ITS-90 reference
+    function in 0 .. 130 degree C, error is below 0.01 degree C)
+    */
+    static constexpr double PEN_COLD_JUNCTION_POLYNOMIAL[] = {
+        3.605433e-4, 3.937976e-2, 2.731623e-5, -1.153139e-7,
+    };
+
+private:
+    // 32 segments of 128 mV on ADC input (0.88 mV of thermocouple),
+    // interpolation error is below 0.06 degree C up to 500 degree C
+    static constexpr lib::LinearTable<32, 11> pen_temperature_table{
+        PEN_TEMPERATURE_POLYNOMIAL, 1.0 / (PEN_VOLTAGE_SCALE * PEN_AMPLIFIER_GAIN), 1000};
+    // 8 segments of 16.384 degree C of cold junction, output is voltage
+    // on ADC input in 1/PEN_VOLTAGE_SCALE mV
+    static constexpr lib::LinearTable<8, 14> pen_cold_junction_table{
+        PEN_COLD_JUNCTION_POLYNOMIAL, 1.0 / 1000, PEN_VOLTAGE_SCALE * PEN_AMPLIFIER_GAIN};
+
+public:
+
+    /** Interface for receiving finished measurements
+    adc_measure_done() is called from DMA interrupt,
+    adc_cpu_voltage_low() from ADC interrupt of analog watchdog
+    */
+    class Listener {
+    public:
+        virtual void adc_measure_done() = 0;
+        virtual void adc_cpu_voltage_low() = 0;
+    };
+
+private:
+    Listener *listener = nullptr;
+
+public:
+
+    /** Set listener which is notified from interrupt after each measurement
+
+    Arguments:
+        l: listener
+    */
+    void set_listener(Listener &l) {
+        listener = &l;
+    }
+
     inline int get_cpu_voltage() {
         return actual_cpu_voltage;
     }
@@ -161,6 +339,18 @@ public:
         return pen_sensor_ok;
     }
 
+    /** Set calibration of inserted tip
+    (applied to thermocouple temperature difference)
+
+    Arguments:
+        offset_mc: offset in 1/1000 degree C
+        gain: gain in Q PEN_GAIN_Q
+    */
+    void set_pen_calibration(const int offset_mc, const int32_t gain) {
+        pen_temperature_offset = offset_mc;
+        pen_temperature_gain = gain;
+    }
+
     void init_hw() {
         // GPIO
         pen_current_input.configure_analog();
@@ -174,50 +364,125 @@ public:
             r_adc.CR.b.ADEN = true;
         }
         while (!r_adc.ISR.b.ADRDY);
-        r_adc.SMPR.b.SMP = io::Adc::Smpr::Smp::SMP_71_5;
+        r_adc.SMPR.b.SMP = io::Adc::Smpr::Smp::SMP_28_5;
         io::Adc::Cfgr1 cfgr1(0x00000000);
         cfgr1.b.RES = io::Adc::Cfgr1::Res::RES_12;
         cfgr1.b.ALIGN = true;
         cfgr1.b.DMAEN = true;
+        cfgr1.b.DMACFG = true;  // circular DMA
+        cfgr1.b.CONT = true;
         r_adc.CFGR1.r = cfgr1.r;
         io::Adc::Ccr ccr(0x00000000);
         ccr.b.VREFEN = true;
         ccr.b.TSEN = true;
         r_adc.CCR.r = ccr.r;
+        init_calibration();
+        // NVIC
+        io::NVIC.iser(io::isr::DMA1_CH1_isr);
+        io::NVIC.iser(io::isr::ADC_isr);
     }
 
-    void measure_idle_start() {
-        measure_mode = MeasureMode::IDLE;
-        io::Adc::Chselr chselr(0x00000000);
-        chselr.b.CHSEL0 = true;  // pen_current
-        chselr.b.CHSEL1 = true;  // pen_temperature
-        chselr.b.CHSEL3 = true;  // supply_voltage
-        chselr.b.CHSEL16 = true;  // cpu_temperature
-        chselr.b.CHSEL17 = true;  // cpu_reference
-        r_adc.CHSELR.r = chselr.r;
-        start_dma_measure(5);
+    /** Set CPU voltage watched by analog watchdog and start conversion
+    (watchdog can be configured only while ADC is not converting)
+
+    Reference has constant voltage, so its conversion rise when CPU voltage
+    fall. Watchdog compares each conversion of reference, so low voltage is
+    detected within one scan, not after whole measurement.
+
+    Arguments:
+        voltage_min_mv: lowest CPU voltage
+    */
+    void start(const int voltage_min_mv) {
+        // threshold compare raw 12 bit conversion (before alignment)
+        r_adc.TR.b.HT = (calibration.cpu_reference / voltage_min_mv) >> 4;
+        r_adc.TR.b.LT = 0;
+        r_adc.CFGR1.b.AWDCH = 17;  // cpu_reference
+        r_adc.CFGR1.b.AWDSGL = true;
+        r_adc.CFGR1.b.AWDEN = true;
+        start_dma_scan();
+    }
+
+    /** Enable interrupt of analog watchdog
+
+    Arguments:
+        enable: true to notify listener when CPU voltage fall below limit
+    */
+    void watch_cpu_voltage(const bool enable) {
+        io::Adc::Isr isr(0x00000000);
+        isr.b.AWD = true;
+        r_adc.ISR.r = isr.r;
+        r_adc.IER.b.AWDIE = enable;
+    }
+
+    /** Request measurement with pen heater off
+
+    ADC is converting continuously. When mode of measurement changes,
+    block in progress is dropped, so measurement contains only scans
+    taken after this call. Repeated request of same mode use block in
+    progress, which can contain scans from before this call (conditions
+    are same), so consecutive measurements follow without gap.
+
+    Arguments:
+        settle: number of next measurements dropped before measurement
+            (settling of amplifier after heater is switched off)
+    */
+    void measure_idle_start(const int settle=0) {
+        measure_start(MeasureMode::IDLE, settle);
     }
 
+    /** Request measurement with pen heater on
+    (same as measure_idle_start)
+    */
     void measure_heat_start() {
-        measure_mode = MeasureMode::HEAT;
-        io::Adc::Chselr chselr(0x00000000);
-        chselr.b.CHSEL0 = true;  // pen_current
-        chselr.b.CHSEL3 = true;  // supply_voltage
-        chselr.b.CHSEL17 = true;  // cpu_reference
-        r_adc.CHSELR.r = chselr.r;
-        start_dma_measure(3);
+        measure_start(MeasureMode::HEAT, 0);
     }
 
+    /** Check if measurement is done
+    (values are already calculated in interrupt)
+
+    Return:
+        true once for each finished measurement
+    */
     bool measure_is_done() {
-        if (!r_dma.ISR.TCIF(DMA_CH_ADC)) return false;
+        if (!measure_done) return false;
+        measure_done = false;
+        return true;
+    }
+
+    /** Interrupt handler
+    need to call manually from interrupt handler routine
+    */
+    void handler() {
+        bool half_done = r_dma.ISR.HTIF(DMA_CH_ADC);
+        bool full_done = r_dma.ISR.TCIF(DMA_CH_ADC);
         r_dma.IFCR.clear_flags(DMA_CH_ADC);
+        if (!half_done && !full_done) return;
+        if (!measure_armed) return;
+        if (measure_skip) {
+            measure_skip--;
+            return;
+        }
+        cumulate(full_done ? 1 : 0);
         switch (measure_mode) {
-            case MeasureMode::NONE: return false;
+            case MeasureMode::NONE: return;
             case MeasureMode::IDLE: calculate_idle(); break;
             case MeasureMode::HEAT: calculate_heat(); break;
         }
-        measure_mode = MeasureMode::NONE;
-        return true;
+        measure_armed = false;
+        measure_done = true;
+        if (listener) listener->adc_measure_done();
+        // listener can request next measurement
+        if (!measure_armed) measure_irq(false);
+    }
+
+    /** Interrupt handler of analog watchdog
+    need to call manually from interrupt handler routine
+    */
+    void watchdog_handler() {
+        if (!r_adc.ISR.b.AWD) return;
+        // disable until next pulse, watchdog flag is set by each conversion
+        watch_cpu_voltage(false);
+        if (listener) listener->adc_cpu_voltage_low();
     }
 };
 
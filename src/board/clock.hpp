@@ -32,13 +32,21 @@ public:
         io::RCC.CFGR.b.PPRE = io::Rcc::Cfgr::Ppre::DIV_1;
 
         // Enable clock for peripherals
+        io::RCC.APB2ENR.b.SYSCFG = true;
         io::RCC.AHBENR.b.GPIOA = true;
         io::RCC.AHBENR.b.GPIOB = true;
         io::RCC.APB2ENR.b.USART1 = true;
         io::RCC.AHBENR.b.DMA1 = true;
         io::RCC.APB2ENR.b.ADC = true;
+        io::RCC.APB2ENR.b.TIM16 = true;
         io::RCC.APB1ENR.b.I2C1 = true;
     }
+
+    /** Sleep CPU until next interrupt
+    */
+    inline void sleep() {
+        asm volatile ("wfi");
+    }
 };
 
 extern Clock clock;
@@ -9,3 +9,7 @@ Debug debug;
 void USART1_handler() {
     board::debug.uart.handler();
 }
+
+void DMA1_CH4_5_handler() {
+    board::debug.uart.dma_handler();
+}
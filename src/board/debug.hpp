@@ -2,6 +2,7 @@
 
 #include "io/reg/cortexm/nvic.hpp"
 #include "io/reg/stm32/f0/isr.hpp"
+#include "io/reg/stm32/f0/syscfg.hpp"
 #include "board/gpio.hpp"
 #include "board/usart.hpp"
 #include "board/clock.hpp"
@@ -10,23 +11,29 @@
 namespace board {
 
 class Debug {
+    // DMA channel 2 is used by I2C, USART1 TX is remapped to channel 4
+    static const unsigned DMA_CH_UART_TX = 4;
+
 public:
 
     GpioPin<io::base::GPIOB, 0> output;
     GpioPin<io::base::GPIOA, 2> debug_tx;
 
-    Usart<io::base::USART1, 0, 500> uart;
+    Usart<io::base::USART1, 0, 500, DMA_CH_UART_TX> uart;
     lib::OStream dbg;
 
     void init_hw() {
         output.configure_output().configure_otype(gpio::Otype::PUSH_PULL).configure_ospeed(gpio::Ospeed::LOW).clr();
         debug_tx.configure_af(1).configure_otype(gpio::Otype::PUSH_PULL).configure_ospeed(gpio::Ospeed::MEDIUM);
+        // DMA
+        io::SYSCFG.CFGR1.b.USART1_TX_DMA_RMP = true;
         // USART
         uart.set_baud_rate(115200, board::Clock::CORE_FREQ).enable().enable_tx();
         dbg.set_file_out(uart);
 
         // NVIC
         io::NVIC.iser(io::isr::USART1_isr);
+        io::NVIC.iser(io::isr::DMA1_CH4_5_isr);
     }
 };
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include "board/gpio.hpp"
 #include "board/i2c.hpp"
 #include "board/ssd1306.hpp"
@@ -8,7 +9,7 @@
 
 namespace board {
 
-class Display {
+class Display : public I2c::Listener {
     board::I2c &i2c;
 
     GpioPin<io::base::GPIOA, 15> oled_nrst;
@@ -43,36 +44,196 @@ private:
         Ssd1306::DISPLAYON,
     };
 
-    struct {
-        unsigned char dummy[3];  // dummy bytes to keep alignment of frame buffer
-        unsigned char display_buffer_cmds[1] = {
+    static const int DISPLAY_PAGES = DISPLAY_HEIGHT / 8;
+    static const int DISPLAY_SIZE = DISPLAY_WIDTH * DISPLAY_PAGES;
+
+    /** Set of commands which select drawing window followed by data
+
+    Control bytes with continuation bit allow to send address commands
+    and data in one I2C transfer
+    */
+    struct WindowCmds {
+        unsigned char cmds[13] = {
+            Ssd1306::CMD, Ssd1306::COLUMNADDR,
+            Ssd1306::CMD, 0,
+            Ssd1306::CMD, (unsigned char)(DISPLAY_WIDTH - 1),
+            Ssd1306::CMD, Ssd1306::PAGEADDR,
+            Ssd1306::CMD, 0,
+            Ssd1306::CMD, (unsigned char)(DISPLAY_PAGES - 1),
             Ssd1306::CO_DATA,
         };
+
+        void set_window(const int column_start, const int column_end, const int page_start, const int page_end) {
+            cmds[3] = column_start;
+            cmds[5] = column_end;
+            cmds[9] = page_start;
+            cmds[11] = page_end;
+        }
+    };
+
+    // front buffer: frame on the wire, whole frame is sent by DMA directly
+    // from it, so window commands are placed before it
+    struct {
+        unsigned char dummy[3];  // dummy bytes to keep alignment of frame buffer
+        WindowCmds window;
         Fb fb;
-    } fb_cmds;
+    } front_cmds;
+
+    // back buffer: frame rendered by screens
+    Fb back;
+
+    // single page of changed columns
+    struct {
+        WindowCmds window;
+        unsigned char data[DISPLAY_WIDTH];
+    } page_cmds;
+
+    // changed columns of front buffer which are not sent yet
+    // (page is clean if start is above end)
+    unsigned char dirty_start[DISPLAY_PAGES];
+    unsigned char dirty_end[DISPLAY_PAGES];
+    int next_page = 0;
+    bool back_ready = false;
+
+    void clear_dirty() {
+        memset(dirty_start, DISPLAY_WIDTH, sizeof(dirty_start));
+        memset(dirty_end, 0, sizeof(dirty_end));
+    }
+
+    /** Move back buffer to front buffer
+
+    Display keep content of front buffer, so only changed bytes are
+    copied and their columns are marked dirty in each page. Back buffer
+    is free for rendering of next frame after this.
+    */
+    void swap_buffers() {
+        const unsigned char *src = back.get_buffer();
+        unsigned char *dst = front_cmds.fb.get_buffer();
+        for (int column = 0; column < DISPLAY_WIDTH; column++) {
+            for (int page = 0; page < DISPLAY_PAGES; page++) {
+                const int i = column * DISPLAY_PAGES + page;
+                if (dst[i] == src[i]) continue;
+                dst[i] = src[i];
+                if (column < dirty_start[page]) dirty_start[page] = column;
+                if (column > dirty_end[page]) dirty_end[page] = column;
+            }
+        }
+    }
+
+    /** Send changed columns of one page
+
+    In vertical addressing mode the frame buffer contains all pages of one
+    column together, so changed bytes of page are collected into page_cmds
+    and front buffer is not read by DMA
+
+    Arguments:
+        page: page to send
+
+    Return:
+        true if transfer was started
+    */
+    bool redraw_page(const int page) {
+        const int column_start = dirty_start[page];
+        const int column_end = dirty_end[page];
+        if (column_start > column_end) return false;
+        dirty_start[page] = DISPLAY_WIDTH;
+        dirty_end[page] = 0;
+        const unsigned char *buffer = front_cmds.fb.get_buffer();
+        unsigned char *data = page_cmds.data;
+        for (int column = column_start; column <= column_end; column++) {
+            *data++ = buffer[column * DISPLAY_PAGES + page];
+        }
+        page_cmds.window.set_window(column_start, column_end, page, page);
+        i2c.write(0x3c, page_cmds.window.cmds, sizeof(page_cmds.window.cmds) + column_end - column_start + 1);
+        return true;
+    }
+
+    /** Send next dirty page, pages are checked in round robin
+
+    Return:
+        true if transfer was started
+    */
+    bool redraw_next_page() {
+        for (int i = 0; i < DISPLAY_PAGES; i++) {
+            const int page = next_page;
+            next_page = (next_page + 1) % DISPLAY_PAGES;
+            if (redraw_page(page)) return true;
+        }
+        return false;
+    }
 
 public:
+    /** Back buffer for rendering
+
+    Rendering is possible at any time, also during transfer
+    */
     inline Fb &get_fb() {
-        return fb_cmds.fb;
+        return back;
     }
 
-    Display(board::I2c &i2c) : i2c(i2c) {}
+    Display(board::I2c &i2c) : i2c(i2c) {
+        clear_dirty();
+    }
 
     void init_hw() {
         oled_nrst.clr();
         oled_nrst.configure_output().configure_otype(gpio::Otype::PUSH_PULL).configure_ospeed(gpio::Ospeed::LOW).clr();
     }
 
-    void redraw() {
-        i2c.write(0x3c, fb_cmds.display_buffer_cmds, sizeof(fb_cmds.display_buffer_cmds) + sizeof(fb_cmds.fb));
+    /** Send whole back buffer to display
+    */
+    void redraw_all() {
+        if (i2c.is_busy()) return;
+        memcpy(front_cmds.fb.get_buffer(), back.get_buffer(), DISPLAY_SIZE);
+        clear_dirty();
+        back_ready = false;
+        front_cmds.window.set_window(0, DISPLAY_WIDTH - 1, 0, DISPLAY_PAGES - 1);
+        i2c.write(0x3c, front_cmds.window.cmds, sizeof(front_cmds.window.cmds) + sizeof(front_cmds.fb));
+    }
+
+    /** Back buffer contains complete frame
+
+    Frame is moved to front buffer by redraw() after previous frame is
+    sent, until then it can be replaced by newer frame
+    */
+    void swap() {
+        back_ready = true;
+    }
+
+    /** Send only changed part of front buffer
+
+    One transfer contain changed columns of one page, remaining pages
+    are sent from I2C interrupt after completion of each transfer, when
+    whole front buffer is sent, buffers are swapped by next call and next
+    frame is started
+
+    Return:
+        true if transfer was started
+    */
+    bool redraw() {
+        if (i2c.is_busy()) return false;
+        if (redraw_next_page()) return true;
+        if (!back_ready) return false;
+        back_ready = false;
+        swap_buffers();
+        return redraw_next_page();
+    }
+
+    /** Continue with next dirty page of front buffer from I2C interrupt
+
+    Back buffer is not touched here, because it can be just rendered
+    */
+    void i2c_transfer_done() override {
+        redraw_next_page();
     }
 
     void init() {
-        fb_cmds.fb.clear();
+        back.clear();
         oled_nrst.set();
         i2c.write(0x3c, init_cmds, sizeof(init_cmds));
         while (i2c.is_busy());
-        redraw();
+        i2c.set_listener(*this);
+        redraw_all();
     }
 };
 
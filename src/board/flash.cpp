@@ -0,0 +1,7 @@
+#include "board/flash.hpp"
+
+namespace board {
+
+Flash flash;
+
+}
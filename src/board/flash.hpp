@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include "io/reg/stm32/f0/flash.hpp"
+
+namespace board {
+
+/** Storage area in last pages of internal flash
+
+Pages are addressed relative to start of storage area, flash is programmed
+by half-words. Programming and erase stall CPU (also interrupts) while
+flash is busy (erase of page take up to 40 ms), so it must not be done
+while heating.
+
+Firmware must not grow into storage area (32 KiB STM32F030x6, last
+PAGES are reserved), this is checked by ld/store.ld, which must be changed
+together with PAGES.
+*/
+class Flash {
+    static const uint32_t FLASH_BASE = 0x08000000;
+    static const uint32_t FLASH_SIZE = 32 * 1024;
+    static const uint32_t KEY1 = 0x45670123;
+    static const uint32_t KEY2 = 0xcdef89ab;
+
+public:
+    static const unsigned PAGE_SIZE = 1024;  // bytes
+    static const int PAGES = 2;  // pages of storage area
+    static const uint32_t STORE_BASE = FLASH_BASE + FLASH_SIZE - PAGES * PAGE_SIZE;
+
+private:
+    static volatile uint16_t *_address(const int page, const unsigned offset) {
+        return reinterpret_cast<volatile uint16_t *>(STORE_BASE + page * PAGE_SIZE + offset);
+    }
+
+    void _unlock() {
+        if (!io::FLASH.CR.b.LOCK) return;
+        io::FLASH.KEYR.FKEYR = KEY1;
+        io::FLASH.KEYR.FKEYR = KEY2;
+    }
+
+    void _lock() {
+        io::FLASH.CR.b.LOCK = true;
+    }
+
+    bool _wait() {
+        while (io::FLASH.SR.b.BSY);
+        bool ok = io::FLASH.SR.b.EOP;
+        // clear flags by writing 1
+        io::Flash::Sr sr(0);
+        sr.b.EOP = true;
+        sr.b.PGERR = true;
+        sr.b.WRPRTERR = true;
+        io::FLASH.SR.r = sr.r;
+        return ok;
+    }
+
+public:
+    /** Read half-word
+
+    Arguments:
+        page: page in storage area
+        offset: offset in page in bytes (even)
+
+    Return:
+        value
+    */
+    uint16_t read(const int page, const unsigned offset) const {
+        return *_address(page, offset);
+    }
+
+    /** Erase page
+
+    Arguments:
+        page: page in storage area
+
+    Return:
+        true if page was erased
+    */
+    bool erase(const int page) {
+        _unlock();
+        io::FLASH.CR.b.PER = true;
+        io::FLASH.AR.FAR = STORE_BASE + page * PAGE_SIZE;
+        io::FLASH.CR.b.STRT = true;
+        bool ok = _wait();
+        io::FLASH.CR.b.PER = false;
+        _lock();
+        return ok;
+    }
+
+    /** Program half-word (only erased half-word can be programmed)
+
+    Arguments:
+        page: page in storage area
+        offset: offset in page in bytes (even)
+        value: value to program
+
+    Return:
+        true if value was programmed
+    */
+    bool program(const int page, const unsigned offset, const uint16_t value) {
+        _unlock();
+        io::FLASH.CR.b.PG = true;
+        *_address(page, offset) = value;
+        bool ok = _wait();
+        io::FLASH.CR.b.PG = false;
+        _lock();
+        return ok && read(page, offset) == value;
+    }
+};
+
+extern Flash flash;
+
+}
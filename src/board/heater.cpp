@@ -5,3 +5,7 @@ namespace board {
 Heater heater;
 
 }
+
+void TIM16_handler() {
+    board::heater.handler();
+}
@@ -1,18 +1,44 @@
 #pragma once
 
+#include "io/reg/cortexm/nvic.hpp"
+#include "io/reg/stm32/f0/isr.hpp"
+#include "io/reg/stm32/f0/tim.hpp"
 #include "board/gpio.hpp"
 
 namespace board {
 
+/** Heater output
+
+Heater can be switched manually by on() and off() or for exact time
+by pulse(), where heater is switched off from one-pulse timer interrupt.
+(PB3 has no timer channel on STM32F030, so output is switched in interrupt)
+*/
 class Heater {
 
     // GpioPin<io::base::GPIOB, 6> output;  // V0.1
     GpioPin<io::base::GPIOB, 3> output;  // V0.2+
 
+    io::Tim &r_tim = io::TIM(io::base::TIM16);
+
 public:
+    static const unsigned TIMER_PRESCALER = 32;  // 4 us at 8 MHz, longest pulse is 262 ms
+    static const unsigned PULSE_MIN_TICKS = 2 * TIMER_PRESCALER;
+    static const unsigned PULSE_MAX_TICKS = 0x10000 * TIMER_PRESCALER;
 
     void init_hw() {
         output.configure_output().configure_otype(gpio::Otype::PUSH_PULL).configure_ospeed(gpio::Ospeed::LOW).clr();
+        // TIM16 in one pulse mode
+        r_tim.CR1.r = 0;
+        r_tim.PSC.PSC = TIMER_PRESCALER - 1;
+        io::Tim::Cr1 cr1(0x00000000);
+        cr1.b.OPM = true;
+        cr1.b.URS = true;  // only overflow generate interrupt
+        r_tim.CR1.r = cr1.r;
+        r_tim.EGR.b.UG = true;  // load prescaler
+        r_tim.SR.r = 0;
+        r_tim.DIER.b.UIE = true;
+        // NVIC
+        io::NVIC.iser(io::isr::TIM16_isr);
     }
 
     void on() {
@@ -20,6 +46,40 @@ public:
     }
 
     void off() {
+        r_tim.CR1.b.CEN = false;
+        output.clr();
+    }
+
+    /** Switch heater on for exact time
+
+    Arguments:
+        ticks: length of pulse in CPU ticks
+
+    Return:
+        real length of pulse in CPU ticks (rounded to TIMER_PRESCALER)
+    */
+    unsigned pulse(unsigned ticks) {
+        if (ticks < PULSE_MIN_TICKS) ticks = PULSE_MIN_TICKS;
+        if (ticks > PULSE_MAX_TICKS) ticks = PULSE_MAX_TICKS;
+        ticks /= TIMER_PRESCALER;
+        r_tim.CR1.b.CEN = false;
+        r_tim.CNT.CNT = 0;
+        r_tim.ARR.ARR = ticks - 1;
+        output.set();
+        r_tim.CR1.b.CEN = true;
+        return ticks * TIMER_PRESCALER;
+    }
+
+    bool is_on() {
+        return output.get();
+    }
+
+    /** Interrupt handler
+    need to call manually from interrupt handler routine
+    */
+    void handler() {
+        if (!r_tim.SR.b.UIF) return;
+        r_tim.SR.b.UIF = false;
         output.clr();
     }
 };
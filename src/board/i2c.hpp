@@ -27,6 +27,28 @@ private:
     volatile bool busy = false;
 
 public:
+    /** Interface for continuing transfers
+    i2c_transfer_done() is called from I2C interrupt after stop condition,
+    so next transfer can be started from it
+    */
+    class Listener {
+    public:
+        virtual void i2c_transfer_done() = 0;
+    };
+
+private:
+    Listener *listener = nullptr;
+
+public:
+    /** Set listener which is notified from interrupt after each transfer
+
+    Arguments:
+        l: listener
+    */
+    void set_listener(Listener &l) {
+        listener = &l;
+    }
+
     void init_hw() {
         // GPIO
         sda.configure_af(4).configure_otype(gpio::Otype::OPEN_DRAIN).configure_pull(gpio::Pull::PULL_UP);
@@ -96,6 +118,7 @@ public:
             icr.b.STOPCF = true;
             r_i2c.ICR.r = icr.r;
             busy = false;
+            if (listener) listener->i2c_transfer_done();
         }
     }
 
@@ -1,22 +1,53 @@
 #pragma once
 
 #include "io/reg/stm32/f0/usart.hpp"
+#include "io/reg/stm32/f0/dma.hpp"
 #include "lib/iofile.hpp"
 #include "lib/fifo.hpp"
 
 /** USART driver
+
+With DMA_CH_TX output FIFO is transmitted by DMA, each transfer send
+continuous part of FIFO and transfer complete interrupt (dma_handler())
+start next part. Without DMA each character is written from TXE interrupt.
 */
 
 namespace board {
 
-template <size_t UART_BASE, int FIFO_IN_SIZE=0, int FIFO_OUT_SIZE=0>
+template <size_t UART_BASE, int FIFO_IN_SIZE=0, int FIFO_OUT_SIZE=0, unsigned DMA_CH_TX=0>
 class Usart : public lib::IOFile {
+    static_assert(!DMA_CH_TX || FIFO_OUT_SIZE, "DMA transmit need output FIFO");
 
     io::Usart &r_usart = io::USART(UART_BASE);
+    io::Dma &r_dma = io::DMA(io::base::DMA1);
+    io::Dma::Channel &r_dma_tx = r_dma.CHANNEL(DMA_CH_TX ? DMA_CH_TX : 1);
 
     lib::Fifo<char, FIFO_IN_SIZE> fifo_in;
     lib::Fifo<char, FIFO_OUT_SIZE> fifo_out;
 
+    volatile int dma_tx_len = 0;  // length of running DMA transfer
+
+    void dma_tx_start() {
+        if (dma_tx_len) return;
+        int len = fifo_out.get_continuous_used();
+        if (!len) return;
+        dma_tx_len = len;
+        r_dma.IFCR.clear_flags(DMA_CH_TX);
+        r_dma_tx.CCR.r = 0x00000000;
+        r_dma_tx.CMAR.MAR = reinterpret_cast<size_t>(fifo_out.get_tail());
+        r_dma_tx.CPAR.PAR = reinterpret_cast<size_t>(&r_usart.TDR);
+        r_dma_tx.CNDTR.NDT = len;
+        io::Dma::Channel::Ccr dma_tx_ccr(0x00000000);
+        dma_tx_ccr.b.EN = true;
+        dma_tx_ccr.b.TCIE = true;
+        dma_tx_ccr.b.DIR = true;
+        dma_tx_ccr.b.MINC = true;
+        dma_tx_ccr.b.PSIZE = (uint32_t)io::Dma::Channel::Ccr::Size::SIZE_8;
+        dma_tx_ccr.b.MSIZE = (uint32_t)io::Dma::Channel::Ccr::Size::SIZE_8;
+        dma_tx_ccr.b.PL = (uint32_t)io::Dma::Channel::Ccr::Pl::LOW;
+        r_dma_tx.CCR.r = dma_tx_ccr.r;
+    }
+
 public:
     ~Usart() {
         close();
@@ -36,6 +67,7 @@ public:
 
     Usart &enable_tx(bool en=true) {
         r_usart.CR1.b.TE = en;
+        if (DMA_CH_TX) r_usart.CR3.b.DMAT = en;
         return *this;
     }
 
@@ -45,6 +77,11 @@ public:
     }
 
     void write_char(char data) override {
+        if (DMA_CH_TX) {
+            while (!fifo_out.push(data)) dma_tx_start();
+            dma_tx_start();
+            return;
+        }
         if (FIFO_OUT_SIZE) {
             while (fifo_out.is_full());
             r_usart.CR1.b.TXEIE = false;
@@ -59,6 +96,32 @@ public:
         r_usart.TDR.DR = data;
     }
 
+    /** Number of characters which can be written without waiting
+
+    Return:
+        free space in output buffer
+    */
+    int get_tx_free() const {
+        if (FIFO_OUT_SIZE) return fifo_out.get_free();
+        return r_usart.ISR.b.TXE ? 1 : 0;
+    }
+
+    void write_data(const char *data, int len) override {
+        if (!DMA_CH_TX) {
+            lib::IOFile::write_data(data, len);
+            return;
+        }
+        while (len > 0) {
+            if (fifo_out.push(*data)) {
+                data++;
+                len--;
+            } else {
+                dma_tx_start();
+            }
+        }
+        dma_tx_start();
+    }
+
     int read_char() {
         if (FIFO_IN_SIZE) {
             char data;
@@ -91,11 +154,27 @@ public:
         }
     }
 
+    /** DMA transfer complete interrupt handler
+    need to call manually from interrupt handler routine
+    */
+    void dma_handler() {
+        if (!r_dma.ISR.TCIF(DMA_CH_TX)) return;
+        r_dma.IFCR.clear_flags(DMA_CH_TX);
+        r_dma_tx.CCR.r = 0x00000000;
+        fifo_out.skip(dma_tx_len);
+        dma_tx_len = 0;
+        dma_tx_start();
+    }
+
     void close() {
         r_usart.CR1.r = 0;
         r_usart.CR2.r = 0;
         r_usart.CR3.r = 0;
         r_usart.BRR.r = 0;
+        if (DMA_CH_TX) {
+            r_dma_tx.CCR.r = 0x00000000;
+            dma_tx_len = 0;
+        }
         if (FIFO_OUT_SIZE) fifo_out.reset();
         if (FIFO_IN_SIZE) fifo_in.reset();
     }
@@ -5,19 +5,28 @@
 #include "screen/screen.hpp"
 #include "screen/main.hpp"
 #include "screen/info.hpp"
+#include "screen/autotune.hpp"
+#include "screen/calibration.hpp"
 
 class Display {
+public:
+    static const int BUTTONS_SAMPLE_TICKS = board::Clock::CORE_FREQ / 1000 * 10;  // ticks
+
+private:
     screen::ScreenHolder _screen_holder;
 
     screen::Main _screen_main;
     screen::Info _screen_info;
+    screen::Autotune _screen_autotune;
+    screen::Calibration _screen_calibration;
 
     screen::Screen *_screens[static_cast<int>(screen::ScreenId::COUNT)] = {
         &_screen_main,
         &_screen_info,
+        &_screen_autotune,
+        &_screen_calibration,
     };
 
-    static const int BUTTONS_SAMPLE_TICKS = board::Clock::CORE_FREQ / 1000 * 10;  // ticks
     int _buttons_sample_ticks = 0;
     lib::Button _button_up;
     lib::Button _button_dw;
@@ -44,10 +53,10 @@ class Display {
     }
 
     void _draw() {
-        if (board::i2c.is_busy()) return;
         auto &fb = board::display.get_fb();
         fb.clear();
         _screen_holder.get()->draw();
+        board::display.swap();
         board::display.redraw();
     }
 
@@ -56,10 +65,26 @@ public:
     Display(Heating &heating) :
         _screen_holder(_screens),
         _screen_main(_screen_holder, heating),
-        _screen_info(_screen_holder, heating) {}
+        _screen_info(_screen_holder, heating),
+        _screen_autotune(_screen_holder, heating),
+        _screen_calibration(_screen_holder, heating) {}
 
-    void process(unsigned delta_ticks) {
+    bool process(unsigned delta_ticks) {
         _buttons_process_fast(delta_ticks);
+        return false;
+    }
+
+    /** Start sending of frame which waits in back buffer
+
+    Pages of one frame are continued from I2C interrupt, this starts next
+    frame when interrupt wake up finds all pages sent
+
+    Return:
+        false, next transfer is started from I2C interrupt wake up
+    */
+    bool refresh(unsigned) {
+        board::display.redraw();
+        return false;
     }
 
     void draw() {
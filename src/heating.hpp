@@ -1,38 +1,137 @@
 #pragma once
 
 #include "board/clock.hpp"
+#include "board/systick.hpp"
 #include "board/heater.hpp"
 #include "board/adc.hpp"
+#include "board/debug.hpp"
 #include "lib/pid.hpp"
+#include "lib/fixed_pid.hpp"
+#include "lib/temperature_estimator.hpp"
+#include "lib/relay_tuner.hpp"
+#include "lib/median.hpp"
+#include "lib/supply_model.hpp"
+#include "lib/brownout_guard.hpp"
 #include "preset.hpp"
+#include "tips.hpp"
+#include "trace.hpp"
+#include "telemetry.hpp"
+#include "profiler.hpp"
 
 /** Class for controlling heating and measuring cycle
 */
-class Heating {
+class Heating : public board::Adc::Listener {
 
+public:
+    enum class Controller {
+        PID,  // lib::Pid
+        FIXED_PID,  // lib::FixedPid (fixed point, without division)
+    };
+
+private:
     Preset _preset;
+    Tips _tips;
+    Controller _controller = Controller::FIXED_PID;
     lib::Pid _pid;
+    lib::FixedPid _fixed_pid;
+    lib::TemperatureEstimator _estimator;
+    lib::RelayTuner _tuner;
+    lib::SupplyModel _supply;
+    lib::BrownoutGuard _brownout;
     uint64_t _uptime_ticks = 0;
 
 public:
     static const int PERIOD_TIME_MS = 150;  // ms
     static const int STANDBY_TIME_MS = 30000;  // s
     static const int PERIOD_TIME_MIN_MS = 50;  // ms
+    static const int PERIOD_ERROR_MC = 20 * 1000;  // 1/1000 degree C, larger error use shortest period
+    // gains for time step in ms (same as 200 and 100 with former 6 steps per second)
     static const int PID_K_PROPORTIONAL = 700;
-    static const int PID_K_INTEGRAL = 200;
-    static const int PID_K_DERIVATE = 100;
+    static const int PID_K_INTEGRAL = 222;
+    static const int PID_K_DERIVATE = 90;
     static const int HEATING_POWER_MAX = 40 * 1000;  // 20.0 W
+    static const int HEATING_POWER_LIMIT_MIN = 2 * 1000;  // mW, lowest power limit from supply model
+    static const int CPU_VOLTAGE_MIN_MV = 2600;  // mV, lowest brownout limit (CPU works from 2.4 V)
+    static const int CPU_VOLTAGE_LIMIT_MV = 2900;  // mV, brownout limit before supply is learned
+    static const int CPU_VOLTAGE_MARGIN_MV = 150;  // mV, learned limit below typical minimum in pulse
+    static const int AUTOTUNE_POWER = 20 * 1000;  // mW, relay output
+    static const int AUTOTUNE_HYSTERESIS_MC = 1000;  // 1/1000 degree C
+    static const int AUTOTUNE_TIMEOUT_MS = 180 * 1000;  // ms
+    // nominal thermal model of RT tip (for temperature estimator)
+    static const int TIP_HEAT_CAPACITY_MJK = 1200;  // mJ/K
+    static const int TIP_THERMAL_RESISTANCE_MKW = 70 * 1000;  // mK/W
+    static const int ESTIMATOR_PROCESS_NOISE_MC = 2000;  // 1/1000 degree C per period
+    static const int ESTIMATOR_MEASUREMENT_NOISE_MC = 1000;  // 1/1000 degree C
 
     /** Initialize module
+
+    Arguments:
+        controller: temperature controller
     */
-    void init() {
-        _pid.set_constants(PID_K_PROPORTIONAL, PID_K_INTEGRAL, PID_K_DERIVATE, 1000 / PERIOD_TIME_MS, HEATING_POWER_MAX);
+    void init(Controller controller=Controller::FIXED_PID) {
+        board::adc.set_listener(*this);
+        _controller = controller;
+        _period_ms = PERIOD_TIME_MS;
+        _period_ticks = _ms2ticks(PERIOD_TIME_MS);
+        _set_pid_constants(PID_K_PROPORTIONAL, PID_K_INTEGRAL, PID_K_DERIVATE);
+        _estimator.set_constants(TIP_HEAT_CAPACITY_MJK, TIP_THERMAL_RESISTANCE_MKW, board::Clock::CORE_FREQ, ESTIMATOR_PROCESS_NOISE_MC, ESTIMATOR_MEASUREMENT_NOISE_MC);
+        _brownout.set_limits(CPU_VOLTAGE_MIN_MV, CPU_VOLTAGE_LIMIT_MV, CPU_VOLTAGE_MARGIN_MV);
+        board::adc.start(CPU_VOLTAGE_MIN_MV);
     }
 
     Preset &get_preset() {
         return _preset;
     }
 
+    Tips &get_tips() {
+        return _tips;
+    }
+
+    const Tips &get_tips() const {
+        return _tips;
+    }
+
+    /** Start PID autotune of inserted tip
+    Relay experiment run at selected preset temperature, found gains are
+    stored into profile of tip.
+
+    Return:
+        true if autotune was started
+    */
+    bool autotune_start() {
+        if (!_tips.is_identified() || _preset.is_standby()) return false;
+        int power_mw = _power_limit_mw < AUTOTUNE_POWER ? _power_limit_mw : AUTOTUNE_POWER;
+        _tuner.start(power_mw, AUTOTUNE_HYSTERESIS_MC, AUTOTUNE_TIMEOUT_MS);
+        return true;
+    }
+
+    /** Abort PID autotune
+    */
+    void autotune_stop() {
+        _tuner.stop();
+    }
+
+    const lib::RelayTuner &get_autotune() const {
+        return _tuner;
+    }
+
+    /** Calibrate thermocouple of inserted tip
+
+    Calibration use last complete idle measurement.
+
+    Arguments:
+        reference_mc: tip temperature measured by reference thermometer
+
+    Return:
+        number of calibration points (see Tips::calibrate), 0 if failed
+    */
+    int calibrate_tip(const int reference_mc) {
+        if (_pen_sensor_status != PenSensorStatus::OK || _preset.is_standby()) return 0;
+        int points = _tips.calibrate(_pen_temperature_mc, reference_mc - _cpu_temperature_mc);
+        if (points) _apply_tip_profile();
+        return points;
+    }
+
     enum class HeatingElementStatus {
         UNKNOWN,
         OK,
@@ -49,20 +148,48 @@ public:
         SHORTED,
     };
 
+    enum class HeaterControl {
+        MEASURED,  // heater is switched off when measured energy reach requested energy
+        TIMED,  // pulse length is calculated from heater power and switched off by timer
+    };
+
+    /** Select how is heating pulse terminated
+
+    Arguments:
+        heater_control: heater control mode
+    */
+    void set_heater_control(HeaterControl heater_control) {
+        _heater_control = heater_control;
+    }
+
     /** Start heating cycle
     */
     void start() {
         int power_mw = 0;
         if (getPenSensorStatus() != Heating::PenSensorStatus::OK) {
             _pid.reset();
+            _fixed_pid.reset();
+            _tuner.stop();
+        } else if (_tuner.is_running()) {
+            power_mw = _autotune_process();
+        } else if (_controller == Controller::FIXED_PID) {
+            Profiler::Scope scope(Profiler::Probe::PID_PROCESS);
+            power_mw = _fixed_pid.process(get_real_pen_temperature_mc(), _preset.get_temperature());
         } else {
+            Profiler::Scope scope(Profiler::Probe::PID_PROCESS);
             power_mw = _pid.process(get_real_pen_temperature_mc(), _preset.get_temperature());
         }
-        _period_ticks = PERIOD_TIME_MS * (board::Clock::CORE_FREQ / 1000);
-        _remaining_ticks += _period_ticks;
         _requested_power_mw = power_mw;
+        trace.record(Trace::Event::POWER_REQUEST, 0, power_mw);
+        _send_telemetry();
+        // PID was processed with length of finished period, next step will use new one
+        int period_ms = _select_period_ms();
+        if (period_ms != _period_ms) _set_period_ms(period_ms);
+        _remaining_ticks += _period_ticks;
+        // steady time is counted once per period, not in each main loop
+        _steady_ms += _period_ms;
         _requested_power_uwpt = (uint64_t)power_mw * _period_ticks * 1000;
-        _state = State::START;
+        _set_state(State::START);
     }
 
     /** Process state machine
@@ -76,7 +203,6 @@ public:
     bool process(unsigned delta_ticks) {
         _uptime_ticks += delta_ticks;
         _remaining_ticks -= delta_ticks;
-        _steady_ticks += delta_ticks;
         switch (_state) {
         case State::STOP:
             _state_stop();
@@ -85,11 +211,9 @@ public:
             _state_start();
             break;
         case State::HEATING:
-            _state_heating(delta_ticks);
+            _state_heating();
             break;
         case State::STABILIZE:
-            _state_stabilize(delta_ticks);
-            break;
         case State::IDLE:
             _state_idle();
             break;
@@ -97,13 +221,30 @@ public:
         return true;
     }
 
+    /** Process finished measurement
+    (called from ADC interrupt)
+    */
+    void adc_measure_done() override {
+        Profiler::Scope scope(Profiler::Probe::ADC_MEASURE);
+        if (_state == State::HEATING) _heat_measured();
+    }
+
+    /** CPU voltage fall below CPU_VOLTAGE_MIN_MV
+    (called from ADC interrupt of analog watchdog)
+    */
+    void adc_cpu_voltage_low() override {
+        if (_state != State::HEATING || !board::heater.is_on()) return;
+        board::heater.off();
+        _brownout.cut_now();
+    }
+
     /** Getter for actual power
 
     Return:
         Actual power in mW
     */
     int get_power_mw() {
-        return _power_uwpt / _period_ticks / 1000;
+        return _power_mw;
     }
 
     /** Getter for requested power
@@ -130,7 +271,17 @@ public:
         total energy in mWh
     */
     int get_energy_mwh() {
-        return _energy_uwt / board::Clock::CORE_FREQ / 1000 / 3600;
+        return _energy_mwh;
+    }
+
+    /** Restore total consumed energy (from settings)
+
+    Arguments:
+        energy_mwh: total energy in mWh
+    */
+    void set_energy_mwh(const uint32_t energy_mwh) {
+        _energy_mwh = energy_mwh;
+        _energy_uwt = 0;
     }
 
     /** Getter how long is pen steady
@@ -139,7 +290,7 @@ public:
         steady time in ms
     */
     int get_steady_ms() {
-        return _steady_ticks / (board::Clock::CORE_FREQ / 1000);
+        return _steady_ms;
     }
 
     /** Getter for CPU voltage during heating
@@ -205,6 +356,32 @@ public:
         return _supply_voltage_mv_drop;
     }
 
+    /** Getter for estimated internal resistance of supply
+
+    Return:
+        resistance of supply and cable in mOhm, 0 if it is not known yet
+    */
+    int get_supply_resistance_mo() const {
+        return _supply.get_resistance_mo();
+    }
+
+    /** Getter for limit of requested power
+
+    Return:
+        power which supply deliver into heater during pulse in mW
+        (limited to HEATING_POWER_MAX)
+    */
+    int get_power_limit_mw() const {
+        return _power_limit_mw;
+    }
+
+    /** Getter for brownout guard
+    (learned limit of CPU voltage and number of cut pulses)
+    */
+    const lib::BrownoutGuard &get_brownout() const {
+        return _brownout;
+    }
+
     /** Getter for CPU temperature
     (used for measuring temperature of other end of thermo coupler in pen)
 
@@ -225,6 +402,29 @@ public:
         return _pen_temperature_mc;
     }
 
+    /** Getter for estimated pen temperature
+    (model prediction fused with last measurement),
+    _select_period_ms() compares it with preset to choose heating period
+
+    Return:
+        temperature in 1/1000 degree Celsius
+    */
+    int get_estimated_pen_temperature_mc() {
+        if (!_estimator.is_valid()) return get_real_pen_temperature_mc();
+        return _estimator.get_temperature_mc();
+    }
+
+    /** Getter for predicted pen temperature
+    (model prediction at end of period before last measurement was
+    fused, so it is estimate without thermocouple, during heating)
+
+    Return:
+        temperature in 1/1000 degree Celsius
+    */
+    int get_predicted_pen_temperature_mc() {
+        return _predicted_pen_temperature_mc;
+    }
+
     /** Getter for real PEN temperature
 
     Return:
@@ -258,24 +458,49 @@ public:
 private:
     static const int IDLE_MIN_TIME_MS = 8;  // ms
     static const int STABILIZE_TIME_MS = 2;  // ms
+    // measurements dropped after heating, stabilize is timed by ADC, which
+    // is the only source of wake up while main loop sleeps
+    static const int STABILIZE_MEASUREMENTS = (board::Clock::CORE_FREQ / 1000 * STABILIZE_TIME_MS + board::Adc::MEASURE_TICKS - 1) / board::Adc::MEASURE_TICKS;
+    static const int IDLE_MEDIAN_SIZE = 5;  // samples in window of spike filter
     static const int HEATING_MIN_POWER_MW = 100;  // mW
+    static const int UNMEASURED_PULSES_MAX = 4;  // timed pulses shorter than measurement, next pulse is measured
     static const int PEN_MAX_CURRENT_MA = 6000;  // mA
     static const int PEN_RESISTANCE_SHORTED = 500;  // mOhm
     static const int PEN_RESISTANCE_MIN = 1500;  // mOhm
     static const int PEN_RESISTANCE_MAX = 2500;  // mOhm
     static const int PEN_RESISTANCE_BROKEN = 100000;  // mOhm
+    static const int TIP_REMOVE_TIME_MS = 1000;  // ms, sensor missing longer is removed tip, shorter is bad contact
+    static const int TIP_IDENTIFY_DIFFERENCE_MAX_MC = 10 * 1000;  // 1/1000 degree C, tip is identified only near cold junction temperature
 
     int64_t _power_uwpt = 0;  // uW * _period_ticks
     int64_t _requested_power_uwpt = 0;  // uW * _period_ticks
-    int64_t _energy_uwt = 0;  // uW * CORE_FREQ
-    int64_t _steady_ticks = 0;  // ticks when power is steady
+    int64_t _energy_uwt = 0;  // uW * ticks, carry below 1 mWh
+    int _energy_mwh = 0;  // mWh
+    int _steady_ms = 0;  // ms when power is steady
+    int _power_mw = 0;  // mW, average power of last period
+    int _period_ms = 0;  // ms, length of actual period
     int _period_ticks = 0;
-    int _remaining_ticks = 0;
+    volatile int _remaining_ticks = 0;  // decremented by main loop, read also in ADC interrupt
 
-    int _measure_ticks = 0;
     int _measurements_count = 0;
+    uint32_t _measure_counter = 0;  // systick counter of last measurement
+    volatile bool _heating_done = false;
+    int _cpu_voltage_mv_sum = 0;  // mV
+    int _supply_voltage_mv_sum = 0;  // mV
+    int _pen_current_ma_sum = 0;  // mA
+    int _cpu_temperature_sum = 0;  // 1/1000 degree C
+    int _pen_temperature_sum = 0;  // 1/1000 degree C
+    lib::Median<int, IDLE_MEDIAN_SIZE> _pen_current_median;
+    lib::Median<int, IDLE_MEDIAN_SIZE> _pen_temperature_median;
+
+    HeaterControl _heater_control = HeaterControl::TIMED;
+    int _heater_power_mw = 0;  // heater power when is switched on
+    int _pulse_ticks = 0;  // length of timed pulse, 0 if pulse is not timed
+    int _pulse_elapsed_ticks = 0;  // time from start of pulse to last measurement
+    int _unmeasured_pulses = 0;  // timed pulses in row without measurement
 
     int _requested_power_mw = 0;  // mW
+    int _power_limit_mw = HEATING_POWER_MAX;  // mW, limit of requested power
     int _cpu_voltage_mv_heat = 0;  // mV
     int _cpu_voltage_mv_idle = 0;  // mV
     int _supply_voltage_mv_heat = 0;  // mV
@@ -286,6 +511,9 @@ private:
     int _pen_resistance_mo = 0;  // mOhm
     int _pen_temperature_mc = 0;  // 1/1000 degree C
     int _cpu_temperature_mc = 0;  // 1/1000 degree C
+    int _predicted_pen_temperature_mc = 0;  // 1/1000 degree C, estimate before last measurement
+    int _sensor_missing_ms = 0;  // ms without thermocouple, up to TIP_REMOVE_TIME_MS
+    bool _sensor_idle_ok = false;  // thermocouple was connected in all samples of idle window
 
     int _average_requested_power = 0;
     int _average_requested_power_short = 0;
@@ -296,11 +524,51 @@ private:
         HEATING,
         STABILIZE,
         IDLE,
-    } _state = State::STOP;
+    };
+    volatile State _state = State::STOP;
+
+    /** Send state of last control step over debug UART
+    (frame is dropped if UART buffer has not enough space)
+    */
+    void _send_telemetry() {
+        bool fixed = _controller == Controller::FIXED_PID;
+        Telemetry::Control control;
+        control.ticks = board::systick.get_ticks();
+        control.pen_temperature_mc = get_real_pen_temperature_mc();
+        control.set_point_mc = _preset.get_temperature();
+        control.cpu_temperature_mc = _cpu_temperature_mc;
+        control.requested_power_mw = _requested_power_mw;
+        control.power_mw = get_power_mw();
+        control.supply_voltage_mv_idle = _supply_voltage_mv_idle;
+        control.supply_voltage_mv_heat = _supply_voltage_mv_heat;
+        control.pen_current_ma = _pen_current_ma_heat;
+        control.pen_resistance_mo = _pen_resistance_mo;
+        control.pid_p = fixed ? _fixed_pid.get_request_p() : _pid.get_request_p();
+        control.pid_i = fixed ? _fixed_pid.get_request_i() : _pid.get_request_i();
+        control.pid_d = fixed ? _fixed_pid.get_request_d() : _pid.get_request_d();
+        control.estimated_temperature_mc = get_predicted_pen_temperature_mc();
+        uint8_t payload[Telemetry::Control::SIZE];
+        control.pack(payload);
+        uint8_t frame[Telemetry::FRAME_SIZE_MAX];
+        int size = Telemetry::encode(Telemetry::Type::CONTROL, payload, sizeof(payload), frame);
+        if (board::debug.uart.get_tx_free() < size) return;
+        board::debug.uart.write_data(reinterpret_cast<char *>(frame), size);
+    }
+
+    void _set_state(const State state) {
+        _state = state;
+        trace.record(Trace::Event::STATE, static_cast<uint8_t>(state));
+    }
 
     HeatingElementStatus _heating_element_status = HeatingElementStatus::UNKNOWN;
     PenSensorStatus _pen_sensor_status = PenSensorStatus::UNKNOWN;
 
+    static constexpr int64_t UWT_PER_MWH = (int64_t)3600 * 1000 * board::Clock::CORE_FREQ;  // uW * ticks
+
+    void _steady_reset() {
+        _steady_ms = 0;
+    }
+
     int64_t _ms2ticks(int64_t time_ms) {
         return time_ms * board::Clock::CORE_FREQ / 1000;
     }
@@ -321,20 +589,20 @@ private:
 
     void _state_start() {
         // reset meters
-        _measure_ticks = 0;
-        _measurements_count = 0;
         _measurements_count = 0;
-        _cpu_voltage_mv_heat = 0;
-        _supply_voltage_mv_heat = 0;
-        _pen_current_ma_heat = 0;
+        _cpu_voltage_mv_sum = 0;
+        _supply_voltage_mv_sum = 0;
+        _pen_current_ma_sum = 0;
         _pen_current_ma_idle = 0;
+        _sensor_idle_ok = true;
         _power_uwpt = 0;
         if (_requested_power_mw < HEATING_MIN_POWER_MW) {
-            board::adc.measure_idle_start();
+            _idle_start();
             _requested_power_mw = 0;
             _requested_power_uwpt = 0;
-            _steady_ticks = 0;
-            _state = State::IDLE;
+            _power_mw = 0;
+            _steady_reset();
+            _set_state(State::IDLE);
             return;
         }
         // calculating derivation of requested power
@@ -348,108 +616,326 @@ private:
         _average_requested_power /= 10;
         int derivate_requested_power = _average_requested_power_short - _average_requested_power;
         if ((derivate_requested_power > 150) || derivate_requested_power < -200) {
-            _steady_ticks = 0;
+            _steady_reset();
         }
+        // heating element status is kept from previous cycle,
+        // because short timed pulse does not need to be measured
+        _pen_sensor_status = PenSensorStatus::UNKNOWN;
+        _heating_done = false;
+        _pulse_elapsed_ticks = 0;
+        _brownout.start();
+        _set_state(State::HEATING);
         // enable heater
-        board::heater.on();
+        board::adc.watch_cpu_voltage(true);
+        _measure_counter = board::systick.get_counter();
+        _pulse_ticks = _calculate_pulse_ticks();
+        if (_pulse_ticks) {
+            _pulse_ticks = board::heater.pulse(_pulse_ticks);
+        } else {
+            board::heater.on();
+        }
         // measure start
         board::adc.measure_heat_start();
-        _heating_element_status = HeatingElementStatus::UNKNOWN;
-        _pen_sensor_status = PenSensorStatus::UNKNOWN;
-        _state = State::HEATING;
     }
 
-    void _state_heating(unsigned delta_ticks) {
-        _measure_ticks += delta_ticks;
-        if (!board::adc.measure_is_done()) return;
-        _measurements_count++;
-        // cumulate measured values
-        _cpu_voltage_mv_heat += board::adc.get_cpu_voltage();
-        _supply_voltage_mv_heat += board::adc.get_supply_voltage();
-        _pen_current_ma_heat += board::adc.get_pen_current();
+    void _set_pid_constants(const int p, const int i, const int d) {
+        // time step is length of actual period
+        _pid.set_constants(p, i, d, _period_ms, _power_limit_mw);
+        _fixed_pid.set_constants(p, i, d, _period_ms, _power_limit_mw);
+    }
+
+    /** Select length of next period
+    Far from set point (approach after heat-up, change of preset) is used
+    short period for fast feedback, near set point long period with
+    smaller measurement overhead. Heating saturated at power limit does not
+    need feedback, so it use long period with highest heating duty, which
+    shorten heat-up when heater power is limited by supply.
+    Bands are compared without division, period is changed only between
+    two lengths, so PID gains are converted only few times per heat-up.
+
+    Return:
+        period in ms
+    */
+    int _select_period_ms() {
+        if (_pen_sensor_status != PenSensorStatus::OK) return PERIOD_TIME_MS;
+        // relay experiment measure period of oscillation
+        if (_tuner.is_running()) return PERIOD_TIME_MS;
+        if (_requested_power_mw >= _power_limit_mw) return PERIOD_TIME_MS;
+        int error_mc = _preset.get_temperature() - get_estimated_pen_temperature_mc();
+        if (error_mc > PERIOD_ERROR_MC || error_mc < -PERIOD_ERROR_MC) return PERIOD_TIME_MIN_MS;
+        return PERIOD_TIME_MS;
+    }
+
+    void _set_period_ms(const int period_ms) {
+        _period_ms = period_ms;
+        _period_ticks = _ms2ticks(period_ms);
+        _pid.set_period_ms(period_ms);
+        _fixed_pid.set_period_ms(period_ms);
+    }
+
+    /** Limit requested power by power which supply deliver into heater
+    during pulse, so PID does not wind up above reachable power
+    (it does not limit supply voltage drop, which is given by heater)
+    */
+    void _update_power_limit() {
+        int limit_mw = _supply.get_load_power_mw(_pen_resistance_mo);
+        if (limit_mw < 0 || limit_mw > HEATING_POWER_MAX) limit_mw = HEATING_POWER_MAX;
+        if (limit_mw < HEATING_POWER_LIMIT_MIN) limit_mw = HEATING_POWER_LIMIT_MIN;
+        if (limit_mw == _power_limit_mw) return;
+        _power_limit_mw = limit_mw;
+        _pid.set_limit(limit_mw);
+        _fixed_pid.set_limit(limit_mw);
+    }
+
+    /** Use PID gains and thermocouple calibration of inserted tip
+    (defaults if tip is not tuned or calibrated)
+    */
+    void _apply_tip_profile() {
+        const Tips::Profile *profile = _tips.get_active();
+        if (profile && profile->is_tuned()) {
+            _set_pid_constants(profile->pid_p, profile->pid_i, profile->pid_d);
+        } else {
+            _set_pid_constants(PID_K_PROPORTIONAL, PID_K_INTEGRAL, PID_K_DERIVATE);
+        }
+        if (profile) {
+            board::adc.set_pen_calibration(profile->temperature_offset_mc, profile->get_temperature_gain());
+        } else {
+            board::adc.set_pen_calibration(0, (int32_t)1 << board::Adc::PEN_GAIN_Q);
+        }
+    }
+
+    /** One step of relay experiment, when it finish gains are stored to tip
+
+    Return:
+        requested power in mW
+    */
+    int _autotune_process() {
+        if (_preset.is_standby()) {
+            _tuner.stop();
+            return 0;
+        }
+        int power_mw = _tuner.process(get_real_pen_temperature_mc(), _preset.get_temperature(), _period_ms);
+        if (_tuner.get_state() != lib::RelayTuner::State::DONE) return power_mw;
+        Tips::Profile *profile = _tips.get_active();
+        int p, i, d;
+        _tuner.get_gains(p, i, d);
+        if (profile && p > 0 && i > 0) {
+            profile->pid_p = p;
+            profile->pid_i = i;
+            profile->pid_d = d;
+        }
+        _apply_tip_profile();
+        return power_mw;
+    }
+
+    /** Calculate length of heating pulse from supply voltage and pen
+    resistance measured in previous cycles
+
+    Return:
+        pulse length in ticks or 0 if heater is switched off by measurement
+    */
+    int _calculate_pulse_ticks() {
+        if (_heater_control != HeaterControl::TIMED) return 0;
+        if (_heating_element_status != HeatingElementStatus::OK) return 0;
+        if (_heater_power_mw <= 0) return 0;
+        // pulse switched off by measurement has at least one measurement,
+        // so element status and over current check are not older than
+        // few periods also at low power
+        if (_unmeasured_pulses >= UNMEASURED_PULSES_MAX) return 0;
+        int64_t pulse_ticks = _requested_power_uwpt / _heater_power_mw / 1000;
+        int64_t max_ticks = _remaining_ticks - _ms2ticks(STABILIZE_TIME_MS + IDLE_MIN_TIME_MS);
+        if (pulse_ticks > max_ticks) pulse_ticks = max_ticks;
+        if (pulse_ticks <= 0) return 0;
+        return pulse_ticks;
+    }
+
+    // called from ADC interrupt, so heater is switched off within one conversion
+    void _heat_measured() {
+        uint32_t counter = board::systick.get_counter();
+        int measure_ticks = ((1 << board::Systick::DIV_BITS) - 1) & (_measure_counter - counter);
+        _measure_counter = counter;
+        _pulse_elapsed_ticks += measure_ticks;
         // cumulate energy
-        _power_uwpt += (int64_t)board::adc.get_supply_voltage() * board::adc.get_pen_current() * _measure_ticks;
-        _measure_ticks = 0;
+        _power_uwpt += (int64_t)board::adc.get_supply_voltage() * board::adc.get_pen_current() * measure_ticks;
+        // timed pulse was already finished by timer during this measurement
+        bool pulse_end = !board::heater.is_on();
+        if (!pulse_end) {
+            // cumulate measured values
+            _measurements_count++;
+            _cpu_voltage_mv_sum += board::adc.get_cpu_voltage();
+            _supply_voltage_mv_sum += board::adc.get_supply_voltage();
+            _pen_current_ma_sum += board::adc.get_pen_current();
+        }
         // check over current
-        bool stop = (_pen_current_ma_heat / _measurements_count) > PEN_MAX_CURRENT_MA;
-        // check reached power
-        stop |= _power_uwpt > _requested_power_uwpt;
+        bool stop = _pen_current_ma_sum > PEN_MAX_CURRENT_MA * _measurements_count;
+        if (_pulse_ticks) {
+            stop |= pulse_end;
+            // measured energy is only safety limit for timed pulse
+            stop |= _power_uwpt > 2 * _requested_power_uwpt;
+        } else {
+            // check reached power
+            stop |= _power_uwpt > _requested_power_uwpt;
+        }
         // check reached time
         stop |= _remaining_ticks < _ms2ticks(STABILIZE_TIME_MS + IDLE_MIN_TIME_MS);
+        // cut pulse before CPU voltage fall below brownout limit
+        // (or pulse was already cut by analog watchdog)
+        if (!pulse_end) _brownout.process(board::adc.get_cpu_voltage());
+        if (_brownout.is_cut()) {
+            stop = true;
+            // energy of timed pulse is calculated from its real length
+            if (_pulse_ticks) _pulse_ticks = _pulse_elapsed_ticks;
+        }
         if (stop) {
             // disable heater
             board::heater.off();
-            _energy_uwt += _power_uwpt;
-            _cpu_voltage_mv_heat /= _measurements_count;
-            _supply_voltage_mv_heat /= _measurements_count;
-            _pen_current_ma_heat /= _measurements_count;
-            // compensate pen current
-            _pen_current_ma_heat -= _pen_current_ma_idle;
-            // absolute value of pen current (will work with reversed current sensor)
-            if (_pen_current_ma_heat < 0) _pen_current_ma_heat *= -1;
-            if (_pen_current_ma_heat > 10) {
-                _pen_resistance_mo = _supply_voltage_mv_heat * 1000 / _pen_current_ma_heat;
-            } else {
-                _pen_resistance_mo = 1000000000;
-            }
-            _supply_voltage_mv_drop = _supply_voltage_mv_heat - _supply_voltage_mv_idle;
-            // check heating element status
-            if (_pen_resistance_mo < PEN_RESISTANCE_SHORTED) {
-                _heating_element_status = HeatingElementStatus::SHORTED;
-            } else if (_pen_resistance_mo < PEN_RESISTANCE_MIN) {
-                _heating_element_status = HeatingElementStatus::LOW_RESISTANCE;
-            } else if (_pen_resistance_mo > PEN_RESISTANCE_BROKEN) {
-                _heating_element_status = HeatingElementStatus::BROKEN;
-            } else if (_pen_resistance_mo > PEN_RESISTANCE_MAX) {
-                _heating_element_status = HeatingElementStatus::HIGH_RESISTANCE;
-            } else {
-                _heating_element_status = HeatingElementStatus::OK;
-            }
-            _state = State::STABILIZE;
+            board::adc.watch_cpu_voltage(false);
+            _heating_done = true;
             return;
         }
         // continue heating
         board::adc.measure_heat_start();
     }
 
-    void _state_stabilize(unsigned delta_ticks) {
-        _measure_ticks += delta_ticks;
-        if (_measure_ticks < _ms2ticks(STABILIZE_TIME_MS)) return;
-        board::adc.measure_idle_start();
-        _measure_ticks = 0;
+    void _state_heating() {
+        if (!_heating_done) return;
+        // supply which can not heat is not tried again until standby is left
+        if (_brownout.finish()) _preset.set_standby();
+        // timed pulse can be shorter than one measurement,
+        // then are kept values from previous cycle
+        if (_measurements_count) {
+            _unmeasured_pulses = 0;
+            _evaluate_heating();
+            trace.record(Trace::Event::PEN_CURRENT, 0, _pen_current_ma_heat);
+            trace.record(Trace::Event::SUPPLY_VOLTAGE, 1, _supply_voltage_mv_heat);
+        } else {
+            _unmeasured_pulses++;
+        }
+        if (_pulse_ticks) {
+            // energy of timed pulse is given by its length
+            _power_uwpt = (int64_t)_heater_power_mw * _pulse_ticks * 1000;
+        }
+        // average power is evaluated once per period, not in each getter
+        _power_mw = _power_uwpt / _period_ticks / 1000;
+        // total energy in mWh with carry, period has at most few mWh
+        _energy_uwt += _power_uwpt;
+        while (_energy_uwt >= UWT_PER_MWH) {
+            _energy_uwt -= UWT_PER_MWH;
+            _energy_mwh++;
+        }
+        _estimator.heat(_power_uwpt);
+        // idle measurement starts after heater transient settles,
+        // sums of heating are not needed anymore
+        _idle_start(STABILIZE_MEASUREMENTS);
+        _set_state(State::STABILIZE);
+    }
+
+    void _evaluate_heating() {
+        _cpu_voltage_mv_heat = _cpu_voltage_mv_sum / _measurements_count;
+        _supply_voltage_mv_heat = _supply_voltage_mv_sum / _measurements_count;
+        _pen_current_ma_heat = _pen_current_ma_sum / _measurements_count;
+        // compensate pen current
+        _pen_current_ma_heat -= _pen_current_ma_idle;
+        // absolute value of pen current (will work with reversed current sensor)
+        if (_pen_current_ma_heat < 0) _pen_current_ma_heat *= -1;
+        if (_pen_current_ma_heat > 10) {
+            _pen_resistance_mo = _supply_voltage_mv_heat * 1000 / _pen_current_ma_heat;
+        } else {
+            _pen_resistance_mo = 1000000000;
+        }
+        _supply_voltage_mv_drop = _supply_voltage_mv_heat - _supply_voltage_mv_idle;
+        bool supply_updated = _supply.update(_supply_voltage_mv_idle, _supply_voltage_mv_heat, _pen_current_ma_heat);
+        // check heating element status
+        if (_pen_resistance_mo < PEN_RESISTANCE_SHORTED) {
+            _heating_element_status = HeatingElementStatus::SHORTED;
+        } else if (_pen_resistance_mo < PEN_RESISTANCE_MIN) {
+            _heating_element_status = HeatingElementStatus::LOW_RESISTANCE;
+        } else if (_pen_resistance_mo > PEN_RESISTANCE_BROKEN) {
+            _heating_element_status = HeatingElementStatus::BROKEN;
+        } else if (_pen_resistance_mo > PEN_RESISTANCE_MAX) {
+            _heating_element_status = HeatingElementStatus::HIGH_RESISTANCE;
+        } else {
+            _heating_element_status = HeatingElementStatus::OK;
+            // limit is recalculated only when model changes
+            if (supply_updated) _update_power_limit();
+            // resistance of heater rise with temperature, so tip is
+            // identified from cold resistance only (hot tip use defaults)
+            if (!_tips.is_identified() && _pen_temperature_mc < TIP_IDENTIFY_DIFFERENCE_MAX_MC) {
+                _tips.identify(_pen_resistance_mo);
+                _apply_tip_profile();
+            }
+        }
+        // heater power for timed pulse
+        if (_pen_resistance_mo > 0) {
+            _heater_power_mw = (int64_t)_supply_voltage_mv_heat * _supply_voltage_mv_heat / _pen_resistance_mo;
+        } else {
+            _heater_power_mw = 0;
+        }
+    }
+
+    void _idle_start(const int settle=0) {
+        board::adc.measure_idle_start(settle);
         _measurements_count = 0;
-        _cpu_voltage_mv_idle = 0;
-        _supply_voltage_mv_idle = 0;
-        _cpu_temperature_mc = 0;
-        _pen_temperature_mc = 0;
-        _state = State::IDLE;
+        // idle values are averaged in sums, so last complete averages are
+        // valid for screens and calibration during whole idle window
+        _cpu_voltage_mv_sum = 0;
+        _supply_voltage_mv_sum = 0;
+        _cpu_temperature_sum = 0;
+        _pen_temperature_sum = 0;
+        _pen_current_median.reset();
+        _pen_temperature_median.reset();
     }
 
     void _state_idle() {
         if (!board::adc.measure_is_done()) return;
-        _cpu_voltage_mv_idle += board::adc.get_cpu_voltage();
-        _supply_voltage_mv_idle += board::adc.get_supply_voltage();
-        _pen_current_ma_idle += board::adc.get_pen_current();
-        _cpu_temperature_mc += board::adc.get_cpu_temperature();
-        // TODO check pen status
-        _pen_temperature_mc += board::adc.get_pen_temperature();
-        _measurements_count++;
-        if (_remaining_ticks > 0) {
+        // first measurement after settling
+        if (_state == State::STABILIZE) _set_state(State::IDLE);
+        // thermocouple and current are filtered by median, averaging
+        // start when window is full, so spikes are not in average
+        _pen_current_median.add(board::adc.get_pen_current());
+        // sample of disconnected thermocouple would be averaged as 0
+        _sensor_idle_ok &= board::adc.is_pen_sensor_ok();
+        _pen_temperature_median.add(board::adc.get_pen_temperature());
+        if (_pen_temperature_median.is_full()) {
+            _cpu_voltage_mv_sum += board::adc.get_cpu_voltage();
+            _supply_voltage_mv_sum += board::adc.get_supply_voltage();
+            _pen_current_ma_idle += _pen_current_median.median();
+            _cpu_temperature_sum += board::adc.get_cpu_temperature();
+            _pen_temperature_sum += _pen_temperature_median.median();
+            _measurements_count++;
+        }
+        // measure at least until window is full
+        if (_remaining_ticks > 0 || !_measurements_count) {
             board::adc.measure_idle_start();
             return;
         }
-        _cpu_voltage_mv_idle /= _measurements_count;
-        _supply_voltage_mv_idle /= _measurements_count;
+        _cpu_voltage_mv_idle = _cpu_voltage_mv_sum / _measurements_count;
+        _supply_voltage_mv_idle = _supply_voltage_mv_sum / _measurements_count;
         _pen_current_ma_idle /= _measurements_count;
-        _cpu_temperature_mc /= _measurements_count;
-        _pen_temperature_mc /= _measurements_count;
+        _cpu_temperature_mc = _cpu_temperature_sum / _measurements_count;
+        _pen_temperature_mc = _pen_temperature_sum / _measurements_count;
+        trace.record(Trace::Event::PEN_TEMPERATURE, 0, _pen_temperature_mc);
+        trace.record(Trace::Event::SUPPLY_VOLTAGE, 0, _supply_voltage_mv_idle);
+        _estimator.cool(_period_ticks, _cpu_temperature_mc);
+        // prediction only from heating pulse and cooling, measurement is not
+        // fused yet (estimate which is available during heating)
+        _predicted_pen_temperature_mc = _estimator.is_valid() ? _estimator.get_temperature_mc() : get_real_pen_temperature_mc();
         // check sensor status
-        if (board::adc.is_pen_sensor_ok()) {
+        if (_sensor_idle_ok) {
             _pen_sensor_status = PenSensorStatus::OK;
+            _sensor_missing_ms = 0;
+            _estimator.update(get_real_pen_temperature_mc());
         } else {
+            _estimator.reset();
+            // tip is forgotten after sensor is missing for TIP_REMOVE_TIME_MS,
+            // so bad contact does not lead to identification of hot tip
+            if (_sensor_missing_ms < TIP_REMOVE_TIME_MS && (_sensor_missing_ms += _period_ms) >= TIP_REMOVE_TIME_MS) {
+                _tips.remove();
+                _apply_tip_profile();
+            }
             _pen_sensor_status = PenSensorStatus::BROKEN;
             _heating_element_status = HeatingElementStatus::UNKNOWN;
         }
-        _state = State::STOP;
+        _set_state(State::STOP);
     }
 };
@@ -0,0 +1,153 @@
+#pragma once
+
+namespace lib {
+
+/** Brownout predictor of CPU voltage during heating pulse
+
+Each measurement of CPU voltage in pulse update filtered slope, voltage
+is extrapolated HORIZON_SAMPLES ahead and pulse has to be cut when
+prediction fall below limit.
+
+Limit is learned per supply: minimum of CPU voltage in each pulse is
+averaged and limit is margin below this typical minimum, clamped between
+absolute minimum and initial limit. Supply which normally sag in pulses
+can run closer to its limit (pulse cut at its first measurement is also
+learned, otherwise such supply could never heat), while sudden collapse
+is still cut before CPU reset.
+
+Sag at start of pulse is faster than measurement, so pulse is also cut
+immediately by analog watchdog at absolute minimum (cut_now()). Supply which
+has pulses repeatedly cut by watchdog or at first measurement can not
+heat at all and is reported as insufficient.
+*/
+class BrownoutGuard {
+    static const int HORIZON_SAMPLES = 4;  // prediction horizon
+    static const int SLOPE_FILTER_SHIFT = 1;  // 1/2 of new slope each sample
+    static const int LEARN_SHIFT = 4;  // 1/16 of new pulse minimum
+    static const int EARLY_CUTS_MAX = 3;  // consecutive early cuts of insufficient supply
+
+    int voltage_min_mv = 0;  // absolute minimum of limit
+    int limit_initial_mv = 0;  // limit before supply is learned
+    int margin_mv = 0;  // distance of limit below typical minimum
+
+    int limit_mv = 0;
+    int typical_min_mv = 0;  // average minimum of completed pulses, 0 if not learned
+    int last_mv = 0;
+    int slope_mv = 0;  // mV per sample
+    int pulse_min_mv = 0;
+    int samples = 0;
+    bool cut = false;
+    unsigned cuts = 0;
+    int early_cuts = 0;  // consecutive pulses cut before or at first measurement
+    bool insufficient = false;
+
+public:
+    /** Set limits
+
+    Arguments:
+        minimum_mv: absolute minimum of CPU voltage
+        initial_mv: limit used before supply is learned
+        distance_mv: distance of learned limit below typical minimum
+    */
+    void set_limits(const int minimum_mv, const int initial_mv, const int distance_mv) {
+        voltage_min_mv = minimum_mv;
+        limit_initial_mv = initial_mv;
+        margin_mv = distance_mv;
+        limit_mv = initial_mv;
+        typical_min_mv = 0;
+    }
+
+    /** New heating pulse
+    */
+    void start() {
+        samples = 0;
+        slope_mv = 0;
+        cut = false;
+    }
+
+    /** Process one measurement in pulse
+    (called from interrupt, only addition, multiplication and shift)
+
+    Arguments:
+        voltage_mv: CPU voltage
+
+    Return:
+        true if pulse must be cut
+    */
+    bool process(const int voltage_mv) {
+        if (samples) {
+            slope_mv += (voltage_mv - last_mv - slope_mv) >> SLOPE_FILTER_SHIFT;
+            if (voltage_mv < pulse_min_mv) pulse_min_mv = voltage_mv;
+        } else {
+            pulse_min_mv = voltage_mv;
+        }
+        last_mv = voltage_mv;
+        samples++;
+        int predicted_mv = voltage_mv;
+        if (slope_mv < 0) predicted_mv += slope_mv * HORIZON_SAMPLES;
+        if (predicted_mv < limit_mv) cut_now();
+        return cut;
+    }
+
+    /** Cut pulse immediately
+    (called from interrupt of analog watchdog)
+    */
+    void cut_now() {
+        if (!cut) cuts++;
+        cut = true;
+    }
+
+    /** Pulse finished, learn typical minimum of pulse
+
+    Return:
+        true if supply was just found insufficient
+    */
+    bool finish() {
+        bool early = cut && samples <= 1;
+        if (early) {
+            early_cuts++;
+        } else if (samples) {
+            early_cuts = 0;
+            insufficient = false;
+        }
+        bool found = early_cuts >= EARLY_CUTS_MAX;
+        if (found) {
+            // next attempt has again EARLY_CUTS_MAX pulses
+            early_cuts = 0;
+            insufficient = true;
+        }
+        if (!samples) return found;
+        if (!typical_min_mv) {
+            typical_min_mv = pulse_min_mv;
+        } else {
+            typical_min_mv += (pulse_min_mv - typical_min_mv) >> LEARN_SHIFT;
+        }
+        limit_mv = typical_min_mv - margin_mv;
+        if (limit_mv > limit_initial_mv) limit_mv = limit_initial_mv;
+        if (limit_mv < voltage_min_mv) limit_mv = voltage_min_mv;
+        return found;
+    }
+
+    bool is_cut() const {
+        return cut;
+    }
+
+    int get_limit_mv() const {
+        return limit_mv;
+    }
+
+    /** Number of cut pulses
+    */
+    unsigned get_cuts() const {
+        return cuts;
+    }
+
+    /** Supply can not heat, pulses were cut at start
+    (until next pulse which was not cut at start)
+    */
+    bool is_supply_insufficient() const {
+        return insufficient;
+    }
+};
+
+}
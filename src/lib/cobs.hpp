@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** Consistent overhead byte stuffing
+
+Encoded data does not contain zero, so zero byte can be used
+as delimiter of frames. Encoding adds one byte per each 254 bytes of data.
+*/
+class Cobs {
+public:
+    static const uint8_t DELIMITER = 0;
+
+    /** Maximum size of encoded data
+
+    Arguments:
+        len: size of data
+
+    Return:
+        maximum size of encoded data (without delimiter)
+    */
+    static constexpr int encoded_size(const int len) {
+        return len + len / 254 + 1;
+    }
+
+    /** Encode data
+
+    Arguments:
+        src: data to encode
+        len: size of data
+        dst: buffer for encoded data with size at least encoded_size(len)
+
+    Return:
+        size of encoded data (without delimiter)
+    */
+    static int encode(const uint8_t *src, int len, uint8_t *dst) {
+        uint8_t *code = dst;
+        uint8_t *ptr = dst + 1;
+        while (len-- > 0) {
+            if (*src) {
+                *ptr++ = *src;
+            }
+            if (!*src++ || ptr - code == 0xff) {
+                *code = ptr - code;
+                code = ptr++;
+                // block with 254 data bytes does not need next code at end of data
+                if (!len && ptr - code == 1 && src[-1]) {
+                    return code - dst;
+                }
+            }
+        }
+        *code = ptr - code;
+        return ptr - dst;
+    }
+
+    /** Decode data
+
+    Arguments:
+        src: encoded data (without delimiter)
+        len: size of encoded data
+        dst: buffer for decoded data with size at least len
+
+    Return:
+        size of decoded data or -1 if data are not valid
+    */
+    static int decode(const uint8_t *src, int len, uint8_t *dst) {
+        const uint8_t *end = src + len;
+        uint8_t *ptr = dst;
+        while (src < end) {
+            int code = *src++;
+            if (!code || src + code - 1 > end) return -1;
+            for (int i = 1; i < code; i++) {
+                if (!*src) return -1;
+                *ptr++ = *src++;
+            }
+            if (code < 0xff && src < end) *ptr++ = 0;
+        }
+        return ptr - dst;
+    }
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xffff)
+
+Computed bitwise, without table to save flash
+*/
+class Crc16 {
+public:
+    static const uint16_t INIT = 0xffff;
+    static const uint16_t POLYNOMIAL = 0x1021;
+
+    /** Update CRC by data
+
+    Arguments:
+        data: data
+        len: size of data
+        crc: CRC of previous data
+
+    Return:
+        updated CRC
+    */
+    static uint16_t update(const uint8_t *data, int len, uint16_t crc=INIT) {
+        while (len-- > 0) {
+            crc ^= *data++ << 8;
+            for (int i = 0; i < 8; i++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ POLYNOMIAL : crc << 1;
+            }
+        }
+        return crc;
+    }
+};
+
+}
@@ -85,6 +85,38 @@ public:
         return head - tail;
     }
 
+    /** Reading number of used items stored continuously from tail
+    (without wrap around end of buffer)
+
+    Return:
+        number of continuous items
+    */
+    int get_continuous_used() const {
+        if (head < tail) {
+            return end - tail;
+        }
+        return head - tail;
+    }
+
+    /** Pointer to oldest item in buffer
+
+    Return:
+        pointer to tail of buffer
+    */
+    const T *get_tail() const {
+        return tail;
+    }
+
+    /** Remove items from buffer without reading
+
+    Arguments:
+        count: number of items to remove (maximum get_continuous_used())
+    */
+    void skip(int count) {
+        tail += count;
+        if (tail >= end) tail = buffer;
+    }
+
     /** Push item into buffer
 
     Arguments:
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** PID controller in fixed point arithmetic without division
+
+All gains are converted into Q format in set_constants(),
+so process() use only multiplication, addition and shift
+(Cortex-M0 has no hardware divider).
+
+Derivative is calculated from measurement (not from error), so change of
+set point does not kick output, and is filtered by first order low-pass,
+small derivative term is not used (dead band same as lib::Pid).
+Integrator is cleared while proportional term alone saturate output
+(heat-up, same as lib::Pid), otherwise it has back-calculation
+anti-windup: when output is saturated, difference between saturated and
+unsaturated output is fed back into integrator.
+
+Arguments of set_constants() and process() are same as in lib::Pid.
+*/
+class FixedPid {
+    static const int Q = 16;  // fractional bits of gains and state
+    static const int D_FILTER_SHIFT = 1;  // derivative low-pass: 1/2 of new value each step
+    static const int TRACKING_SHIFT = 1;  // anti-windup tracking: 1/2 of saturation each step
+    static const int D_DEAD_BAND = 1000;  // mW, smaller derivative term is not used (same as lib::Pid)
+
+    int k_i = 0;
+    int k_d = 0;
+    int32_t k_p_q = 0;  // k_p / 1000
+    int32_t k_i_q = 0;  // k_i / 1000 * period
+    int32_t k_d_q = 0;  // k_d / 1000 / period
+    int request_limit = 0;
+
+    int64_t integral_q = 0;  // mW in Q format
+    int64_t derivate_q = 0;  // mW in Q format
+    int feedback_last = 0;
+    bool first = true;
+    int request_p = 0;  // proportional term of last step (for telemetry)
+    int request_d = 0;  // derivative term of last step (for telemetry)
+
+    static int64_t mul_q(const int value, const int32_t coef_q) {
+        return (int64_t)value * coef_q;
+    }
+
+public:
+    void set_constants(const int p, const int i, const int d, const int t, const int l) {
+        k_p_q = ((int64_t)p << Q) / 1000;
+        k_i = i;
+        k_d = d;
+        set_period_ms(t);
+        request_limit = l;
+        reset();
+    }
+
+    /** Change time step without reset
+    (gains are converted here, so it is called only when period changes)
+    */
+    void set_period_ms(const int t) {
+        k_i_q = ((int64_t)k_i * t << Q) / 1000000;
+        k_d_q = ((int64_t)k_d << Q) / t;
+    }
+
+    /** Change output limit without reset
+    (integrator is pulled below new limit by anti-windup)
+    */
+    void set_limit(const int l) {
+        request_limit = l;
+    }
+
+    void reset() {
+        integral_q = 0;
+        derivate_q = 0;
+        first = true;
+    }
+
+    int process(const int feedback, const int set_point) {
+        // proportional
+        int error_p = set_point - feedback;
+        int64_t request_p_q = mul_q(error_p, k_p_q);
+        // derivate from measurement with low-pass filter
+        if (first) {
+            feedback_last = feedback;
+            first = false;
+        }
+        int64_t derivate_raw_q = mul_q(feedback_last - feedback, k_d_q);
+        derivate_q += (derivate_raw_q - derivate_q) >> D_FILTER_SHIFT;
+        feedback_last = feedback;
+        // integral, cleared while proportional term alone saturate output
+        if (request_p_q > ((int64_t)request_limit << Q)) {
+            integral_q = 0;
+        } else {
+            integral_q += mul_q(error_p, k_i_q);
+        }
+        // requested power in mW
+        int64_t request_d_q = derivate_q;
+        if (request_d_q > -((int64_t)D_DEAD_BAND << Q) && request_d_q < ((int64_t)D_DEAD_BAND << Q)) request_d_q = 0;
+        int64_t request_q = request_p_q + integral_q + request_d_q;
+        int64_t limited_q = request_q;
+        if (limited_q > ((int64_t)request_limit << Q)) limited_q = (int64_t)request_limit << Q;
+        if (limited_q < 0) limited_q = 0;
+        // anti-windup
+        integral_q += (limited_q - request_q) >> TRACKING_SHIFT;
+        if (integral_q > ((int64_t)request_limit << Q)) integral_q = (int64_t)request_limit << Q;
+        if (integral_q < 0) integral_q = 0;
+        int request_power = limited_q >> Q;
+
+        request_p = request_p_q >> Q;
+        request_d = request_d_q >> Q;
+        return request_power;
+    }
+
+    int get_request_p() const {
+        return request_p;
+    }
+
+    int get_request_i() const {
+        return integral_q >> Q;
+    }
+
+    int get_request_d() const {
+        return request_d;
+    }
+
+};
+
+}
@@ -2,7 +2,7 @@
 
 namespace lib {
 
-const uint8_t Font::sans5[] = {
+static constexpr uint8_t SANS5_DATA[] = {
     5, 1,
     '0', 4, 0x0e, 0x11, 0x11, 0x0e,
     '1', 4, 0x00, 0x12, 0x1f, 0x10,
@@ -54,7 +54,7 @@ const uint8_t Font::sans5[] = {
     0,
 };
 
-const uint8_t Font::sans8[] = {
+static constexpr uint8_t SANS8_DATA[] = {
     8, 1,
     '0', 5, 0x3e, 0x41, 0x49, 0x41, 0x3e,
     '1', 5, 0x00, 0x42, 0x7f, 0x40, 0x00,
@@ -156,7 +156,7 @@ const uint8_t Font::sans8[] = {
     0,
 };
 
-const uint8_t Font::num7[] = {
+static constexpr uint8_t NUM7_DATA[] = {
     7, 1,
     '0', 4, 0x3e, 0x41, 0x41, 0x3e,
     '1', 4, 0x00, 0x00, 0x00, 0x7f,
@@ -184,7 +184,7 @@ const uint8_t Font::num7[] = {
     0,
 };
 
-const uint16_t Font::num9[] = {
+static constexpr uint16_t NUM9_DATA[] = {
     9, 2,
     '0', 5, 0x0fe, 0x101, 0x101, 0x101, 0x0fe,
     '1', 5, 0x000, 0x000, 0x000, 0x000, 0x1ff,
@@ -212,7 +212,7 @@ const uint16_t Font::num9[] = {
     0,
 };
 
-const uint16_t Font::num11[] = {
+static constexpr uint16_t NUM11_DATA[] = {
     11, 2,
     '0', 6, 0x3fe, 0x401, 0x401, 0x401, 0x401, 0x3fe,
     '1', 6, 0x000, 0x000, 0x000, 0x000, 0x000, 0x7ff,
@@ -243,7 +243,7 @@ const uint16_t Font::num11[] = {
     0,
 };
 
-const uint16_t Font::num13[] = {
+static constexpr uint16_t NUM13_DATA[] = {
     13, 2,
     '0', 7, 0x0ffe, 0x1001, 0x1001, 0x1001, 0x1001, 0x1001, 0x0ffe,
     '1', 7, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1fff,
@@ -274,7 +274,7 @@ const uint16_t Font::num13[] = {
     0,
 };
 
-const uint32_t Font::num22[] = {
+static constexpr uint32_t NUM22_DATA[] = {
     22, 3,
     '0', 11, 0x1ffffe, 0x3fffff, 0x300003, 0x300003, 0x300003, 0x300003, 0x300003, 0x300003, 0x300003, 0x3fffff, 0x1ffffe,
     '1', 11, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x3fffff, 0x3fffff,
@@ -301,4 +301,20 @@ const uint32_t Font::num22[] = {
     0,
 };
 
+static constexpr auto SANS5_INDEX = Font::make_index<Font::count_glyphs(SANS5_DATA)>(SANS5_DATA);
+static constexpr auto SANS8_INDEX = Font::make_index<Font::count_glyphs(SANS8_DATA)>(SANS8_DATA);
+static constexpr auto NUM7_INDEX = Font::make_index<Font::count_glyphs(NUM7_DATA)>(NUM7_DATA);
+static constexpr auto NUM9_INDEX = Font::make_index<Font::count_glyphs(NUM9_DATA)>(NUM9_DATA);
+static constexpr auto NUM11_INDEX = Font::make_index<Font::count_glyphs(NUM11_DATA)>(NUM11_DATA);
+static constexpr auto NUM13_INDEX = Font::make_index<Font::count_glyphs(NUM13_DATA)>(NUM13_DATA);
+static constexpr auto NUM22_INDEX = Font::make_index<Font::count_glyphs(NUM22_DATA)>(NUM22_DATA);
+
+constexpr Font::Face<uint8_t> Font::sans5 = Font::make_face(SANS5_DATA, SANS5_INDEX);
+constexpr Font::Face<uint8_t> Font::sans8 = Font::make_face(SANS8_DATA, SANS8_INDEX);
+constexpr Font::Face<uint8_t> Font::num7 = Font::make_face(NUM7_DATA, NUM7_INDEX);
+constexpr Font::Face<uint16_t> Font::num9 = Font::make_face(NUM9_DATA, NUM9_INDEX);
+constexpr Font::Face<uint16_t> Font::num11 = Font::make_face(NUM11_DATA, NUM11_INDEX);
+constexpr Font::Face<uint16_t> Font::num13 = Font::make_face(NUM13_DATA, NUM13_INDEX);
+constexpr Font::Face<uint32_t> Font::num22 = Font::make_face(NUM22_DATA, NUM22_INDEX);
+
 }
@@ -6,34 +6,149 @@ namespace lib {
 
 class Font {
 public:
-    static const uint8_t sans5[];
-    static const uint8_t sans8[];
-    static const uint8_t num7[];
-    static const uint16_t num9[];
-    static const uint16_t num11[];
-    static const uint16_t num13[];
-    static const uint32_t num22[];
+    /** Index of glyphs present in font
 
+    Characters are sorted, offset of width of glyph in data is at same
+    position as its character. Only present glyphs are indexed (3 bytes
+    per glyph), so numeric fonts does not pay for whole character range.
+    */
+    template <unsigned G>
+    struct Index {
+        uint8_t chars[G];
+        uint16_t offsets[G];
+    };
+
+    /** Font data with index of glyphs
+
+    Data starts with height and spacing followed by glyph records:
+    character, width and columns of bitmap, terminated by zero.
+    Index is generated at compile time (see make_index()), lookup of glyph
+    is binary search in at most 7 steps instead of walking glyph records
+    */
     template <typename F>
-    static int char_width(const char ch, const F *font) {
-        int spacing = font[1];
-        font += 2;
-        while (*font != ch) {
-            if (*font == 0) return 0;
-            font++;
-            font += *font + 1;
+    struct Face {
+        const F *data;
+        const uint8_t *chars;
+        const uint16_t *offsets;
+        unsigned count;
+
+        inline int get_height() const {
+            return data[0];
+        }
+
+        inline int get_spacing() const {
+            return data[1];
+        }
+
+        /** Find glyph
+
+        Arguments:
+            ch: character
+
+        Return:
+            pointer to width of glyph followed by bitmap or nullptr if font has not this character
+        */
+        inline const F *get_glyph(const char ch) const {
+            const unsigned c = static_cast<unsigned char>(ch);
+            unsigned low = 0;
+            unsigned high = count;
+            while (low < high) {
+                unsigned middle = (low + high) / 2;
+                if (chars[middle] < c) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            if (low >= count || chars[low] != c) return nullptr;
+            return data + offsets[low];
+        }
+    };
+
+    /** Count glyphs in font data
+
+    Arguments:
+        data: font data
+
+    Return:
+        number of glyph records
+    */
+    template <typename F, unsigned N>
+    static constexpr unsigned count_glyphs(const F (&data)[N]) {
+        unsigned count = 0;
+        unsigned offset = 2;
+        while (data[offset]) {
+            count++;
+            offset += data[offset + 1] + 2;
         }
-        font++;
-        return *font + spacing;
+        return count;
+    }
+
+    /** Build index of glyphs sorted by character
+
+    Arguments:
+        data: font data with G glyphs
+
+    Return:
+        index of all glyphs
+    */
+    template <unsigned G, typename F, unsigned N>
+    static constexpr Index<G> make_index(const F (&data)[N]) {
+        Index<G> index{};
+        unsigned count = 0;
+        unsigned offset = 2;
+        while (data[offset]) {
+            // insertion sort, runs only at compile time
+            const uint8_t ch = data[offset];
+            unsigned i = count++;
+            while (i > 0 && index.chars[i - 1] > ch) {
+                index.chars[i] = index.chars[i - 1];
+                index.offsets[i] = index.offsets[i - 1];
+                i--;
+            }
+            index.chars[i] = ch;
+            index.offsets[i] = offset + 1;
+            offset += data[offset + 1] + 2;
+        }
+        return index;
+    }
+
+    /** Build face from font data and its index
+
+    Arguments:
+        data: font data
+        index: index built by make_index() from same data
+
+    Return:
+        face with index of all glyphs
+    */
+    template <typename F, unsigned G>
+    static constexpr Face<F> make_face(const F *data, const Index<G> &index) {
+        return Face<F>{data, index.chars, index.offsets, G};
+    }
+
+    static const Face<uint8_t> sans5;
+    static const Face<uint8_t> sans8;
+    static const Face<uint8_t> num7;
+    static const Face<uint16_t> num9;
+    static const Face<uint16_t> num11;
+    static const Face<uint16_t> num13;
+    static const Face<uint32_t> num22;
+
+    template <typename F>
+    static int char_width(const char ch, const Face<F> &font) {
+        const F *glyph = font.get_glyph(ch);
+        if (!glyph) return 0;
+        return *glyph + font.get_spacing();
     }
 
     template <typename F>
-    static int text_width(const char *text, const F *font) {
+    static int text_width(const char *text, const Face<F> &font) {
         int width = 0;
         while (*text) {
             width += char_width(*text++, font);
         }
-        return width - font[1];
+        return width - font.get_spacing();
     }
 };
 
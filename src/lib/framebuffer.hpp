@@ -3,6 +3,7 @@
 #include <cstring>
 #include <cstdint>
 #include <cmath>
+#include "lib/font.hpp"
 
 namespace lib {
 
@@ -64,22 +65,16 @@ public:
     }
 
     template <typename F>
-    int draw_char(int x, int y, const char ch, const F *font) {
-        int spacing = font[1];
-        font += 2;
-        while (*font != ch) {
-            if (*font == 0) return 0;
-            font++;
-            font += *font + 1;
-        }
-        font++;
-        int width = *font++;
-        draw_bitmap(x, y, width, font);
-        return width + spacing;
+    int draw_char(int x, int y, const char ch, const Font::Face<F> &font) {
+        const F *glyph = font.get_glyph(ch);
+        if (!glyph) return 0;
+        int width = *glyph++;
+        draw_bitmap(x, y, width, glyph);
+        return width + font.get_spacing();
     }
 
     template <typename F>
-    int draw_text(int x, int y, const char *text, const F *font) {
+    int draw_text(int x, int y, const char *text, const Font::Face<F> &font) {
         while (*text) {
             x += draw_char(x, y, *text++, font);
         }
@@ -363,7 +363,7 @@ public:
         reference to instance of this stream
     */
     OStream &operator<<(void *x) {
-        return h(reinterpret_cast<size_t>(x));
+        return hex(reinterpret_cast<size_t>(x), sizeof(size_t) * 2);
     }
 
 };
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include "lib/crc16.hpp"
+
+namespace lib {
+
+/** Log-structured key/value store in flash with RAM shadow
+
+Values are 32 bit, keys are numbers 0 .. KEYS - 1. All values are kept in
+RAM, set() only change RAM shadow and mark value as dirty, dirty values
+are appended into flash by flush() (caller batch changes and flush only
+when flash access does not disturb anything).
+
+Flash pages are used as ring. Each record has 8 bytes (key, value and
+CRC-16), page start with header record (key HEADER, value is sequence
+number of page). When page is full, all values are copied into next
+page, so erases are spread over all pages (wear levelling). Header is
+written as last record of copy, so page without valid header is
+interrupted copy and is ignored. Erased flash read as 0xffff, so first
+empty key is end of log.
+
+load() replay valid pages in order of sequence in one pass, record
+interrupted by power cut has wrong CRC and is skipped.
+
+FLASH must provide PAGE_SIZE, PAGES, read(), erase() and program()
+(half-word access), see board::Flash.
+*/
+template <class FLASH, int KEYS>
+class KvStore {
+    static const uint16_t EMPTY = 0xffff;  // key of erased record
+    static const uint16_t HEADER = 0xfffe;  // first record of page, value is sequence
+    static const unsigned RECORD_SIZE = 8;
+    static const unsigned RECORDS = FLASH::PAGE_SIZE / RECORD_SIZE;
+    static const int NO_PAGE = -1;
+
+    static_assert(KEYS <= 32, "dirty and stored flags are 32 bit");
+    static_assert(KEYS + 2 <= (int)RECORDS, "copy of all values must fit into page with space for new records");
+    static_assert(FLASH::PAGES >= 2, "at least two pages are needed");
+
+    FLASH &flash;
+    uint32_t values[KEYS] = {};
+    uint32_t stored = 0;  // bit for each key which has value
+    uint32_t dirty = 0;  // bit for each key not written to flash
+
+    int page = NO_PAGE;  // page where are appended records
+    uint16_t sequence = 0;  // sequence of page
+    unsigned offset = 0;  // offset of next record in page
+    bool committed = false;  // active page has header (copy of values is complete)
+    bool copy_needed = true;  // values must be copied into new page
+
+    static uint16_t crc(const uint16_t key, const uint32_t value) {
+        const uint8_t data[] = {
+            (uint8_t)key, (uint8_t)(key >> 8),
+            (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24),
+        };
+        return Crc16::update(data, sizeof(data));
+    }
+
+    /** Read record
+
+    Return:
+        true if record is valid
+    */
+    bool read_record(const int p, const unsigned o, uint16_t &key, uint32_t &value) const {
+        key = flash.read(p, o);
+        value = flash.read(p, o + 2) | (uint32_t)flash.read(p, o + 4) << 16;
+        return flash.read(p, o + 6) == crc(key, value);
+    }
+
+    bool is_erased(const int p, const unsigned o) const {
+        for (unsigned i = 0; i < RECORD_SIZE; i += 2) {
+            if (flash.read(p, o + i) != EMPTY) return false;
+        }
+        return true;
+    }
+
+    /** Write record, key is written first and CRC last, so interrupted
+    write is detected by CRC
+    */
+    bool write_record(const unsigned o, const uint16_t key, const uint32_t value) {
+        bool ok = flash.program(page, o, key);
+        ok &= flash.program(page, o + 2, value);
+        ok &= flash.program(page, o + 4, value >> 16);
+        ok &= flash.program(page, o + 6, crc(key, value));
+        return ok;
+    }
+
+    /** Copy all values into next page, failed copy is repeated in same
+    page, so older page with values is kept until header of copy is written
+    (records are never appended into page without header)
+    */
+    bool copy() {
+        if (committed) page = (page + 1) % FLASH::PAGES;
+        committed = false;
+        copy_needed = true;
+        if (!flash.erase(page)) return false;
+        offset = RECORD_SIZE;
+        for (int key = 0; key < KEYS; key++) {
+            if (!(stored & (1 << key))) continue;
+            if (!write_record(offset, key, values[key])) return false;
+            offset += RECORD_SIZE;
+        }
+        if (!write_record(0, HEADER, sequence + 1)) return false;
+        sequence++;
+        committed = true;
+        dirty = 0;
+        copy_needed = false;
+        return true;
+    }
+
+    /** Replay records of one page
+
+    Return:
+        offset of first empty record
+    */
+    unsigned replay(const int p) {
+        unsigned end;
+        for (end = RECORD_SIZE; end < FLASH::PAGE_SIZE; end += RECORD_SIZE) {
+            if (is_erased(p, end)) break;
+            uint16_t key;
+            uint32_t value;
+            if (!read_record(p, end, key, value) || key >= KEYS) continue;
+            values[key] = value;
+            stored |= 1 << key;
+        }
+        return end;
+    }
+
+public:
+    KvStore(FLASH &flash) : flash(flash) {}
+
+    /** Restore values from flash
+    (only reads flash, erase is postponed to flush())
+    */
+    void load() {
+        uint16_t sequences[FLASH::PAGES];
+        bool valid[FLASH::PAGES];
+        int pages = 0;
+        for (int p = 0; p < FLASH::PAGES; p++) {
+            uint16_t key;
+            uint32_t value;
+            valid[p] = read_record(p, 0, key, value) && key == HEADER;
+            sequences[p] = value;
+            if (valid[p]) pages++;
+        }
+        stored = 0;
+        dirty = 0;
+        page = NO_PAGE;
+        // replay from oldest page, sequence can overflow
+        while (pages--) {
+            int oldest = NO_PAGE;
+            for (int p = 0; p < FLASH::PAGES; p++) {
+                if (!valid[p]) continue;
+                if (oldest == NO_PAGE || (int16_t)(sequences[p] - sequences[oldest]) < 0) oldest = p;
+            }
+            valid[oldest] = false;
+            page = oldest;
+            sequence = sequences[oldest];
+            offset = replay(oldest);
+        }
+        committed = true;
+        copy_needed = false;
+        if (page == NO_PAGE) {
+            // empty flash, first copy create page 0
+            page = FLASH::PAGES - 1;
+            sequence = 0;
+            copy_needed = true;
+        }
+    }
+
+    /** Read value
+
+    Arguments:
+        key: key of value
+        value: returned value, unchanged if key has no value
+
+    Return:
+        true if key has value
+    */
+    bool get(const int key, uint32_t &value) const {
+        if (key < 0 || key >= KEYS || !(stored & (1 << key))) return false;
+        value = values[key];
+        return true;
+    }
+
+    /** Change value in RAM, it is written to flash by flush()
+
+    Arguments:
+        key: key of value
+        value: new value
+    */
+    void set(const int key, const uint32_t value) {
+        if (key < 0 || key >= KEYS) return;
+        if ((stored & (1 << key)) && values[key] == value) return;
+        values[key] = value;
+        stored |= 1 << key;
+        dirty |= 1 << key;
+    }
+
+    bool is_dirty() const {
+        return dirty || copy_needed;
+    }
+
+    /** Write dirty values into flash
+
+    Return:
+        true if all values are written
+    */
+    bool flush() {
+        if (copy_needed) return copy();
+        for (int key = 0; key < KEYS; key++) {
+            if (!(dirty & (1 << key))) continue;
+            if (offset + RECORD_SIZE > FLASH::PAGE_SIZE) return copy();
+            if (!write_record(offset, key, values[key])) {
+                // broken record is skipped by load(), copy values into next page
+                offset += RECORD_SIZE;
+                copy_needed = true;
+                return false;
+            }
+            offset += RECORD_SIZE;
+            dirty &= ~(1 << key);
+        }
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** Piecewise linear approximation of polynomial
+
+Table is generated at compile time (constexpr constructor) from
+polynomial coefficients, points are equally spaced by 2^STEP_BITS of
+input, so lookup() find segment by shift and interpolate by one
+multiplication and shift (no division and no floating point at run time).
+Input above last point is extrapolated by last segment.
+*/
+template <int SEGMENTS, int STEP_BITS>
+class LinearTable {
+    int32_t points[SEGMENTS + 1] = {};
+
+    static constexpr double polynomial(const double *coefs, const int count, const double x) {
+        double y = 0;
+        for (int i = count - 1; i >= 0; i--) y = y * x + coefs[i];
+        return y;
+    }
+
+public:
+    static const int32_t STEP = (int32_t)1 << STEP_BITS;
+    static const int32_t INPUT_MAX = (int32_t)SEGMENTS << STEP_BITS;
+
+    /** Generate table
+
+    Arguments:
+        coefs: coefficients of polynomial, from constant term
+        unit: value of one input step in units of polynomial argument
+        scale: output value for 1 of polynomial value
+    */
+    template <int COUNT>
+    constexpr LinearTable(const double (&coefs)[COUNT], const double unit, const double scale=1) {
+        for (int i = 0; i <= SEGMENTS; i++) {
+            double y = scale * polynomial(coefs, COUNT, (double)i * STEP * unit);
+            points[i] = (int32_t)(y < 0 ? y - 0.5 : y + 0.5);
+        }
+    }
+
+    constexpr int32_t get_point(const int index) const {
+        return points[index];
+    }
+
+    /** Interpolate value
+
+    Arguments:
+        input: input value, negative is clamped to 0
+
+    Return:
+        approximated value of polynomial
+    */
+    int32_t lookup(int32_t input) const {
+        if (input < 0) input = 0;
+        int index = input >> STEP_BITS;
+        if (index >= SEGMENTS) index = SEGMENTS - 1;
+        int32_t fraction = input - (index << STEP_BITS);
+        return points[index] + (((points[index + 1] - points[index]) * fraction) >> STEP_BITS);
+    }
+};
+
+}
@@ -1,28 +1,76 @@
 #pragma once
 
-#include <stdlib.h>
-
 namespace lib {
 
+/** Sliding window median filter
+
+Keep last SIZE values in ring, median is selected by sorting network
+(fixed sequence of compare and swap, without sort of whole window), so
+each new value cost constant time. Filter reject up to SIZE / 2 spikes
+in window.
+*/
 template <class T, int SIZE>
 class Median {
-    T sorted[SIZE];
+    static_assert(SIZE == 3 || SIZE == 5, "sorting network is only for 3 or 5 values");
+
+    T window[SIZE];
+    int index = 0;
     int values_count = 0;
 
-    static int compare(const void *a, const void *b) {
-        return *(T *)a - *(T *)b;
+    static void sort(T &a, T &b) {
+        if (a > b) {
+            T tmp = a;
+            a = b;
+            b = tmp;
+        }
     }
 
 public:
-    bool add(const T val) {
-        if (values_count >= SIZE) return false;
-        sorted[values_count++] = val;
-        return true;
+    void reset() {
+        index = 0;
+        values_count = 0;
     }
 
-    T median() {
-        qsort(sorted, SIZE, sizeof(T), compare);
-        return sorted[SIZE / 2];
+    /** Add value, oldest value is dropped when window is full
+
+    Arguments:
+        val: new value
+    */
+    void add(const T val) {
+        window[index] = val;
+        index = (index + 1) % SIZE;
+        if (values_count < SIZE) values_count++;
+    }
+
+    /** Window is full, median is valid
+    */
+    bool is_full() const {
+        return values_count >= SIZE;
+    }
+
+    /** Median of window
+
+    Return:
+        median of last SIZE values, valid only if is_full()
+    */
+    T median() const {
+        T v[SIZE];
+        for (int i = 0; i < SIZE; i++) v[i] = window[i];
+        if constexpr (SIZE == 3) {
+            sort(v[0], v[1]);
+            sort(v[1], v[2]);
+            sort(v[0], v[1]);
+            return v[1];
+        } else {
+            sort(v[0], v[1]);
+            sort(v[3], v[4]);
+            sort(v[0], v[3]);
+            sort(v[1], v[4]);
+            sort(v[1], v[2]);
+            sort(v[2], v[3]);
+            sort(v[1], v[2]);
+            return v[2];
+        }
     }
 };
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include "lib/font.hpp"
+
+namespace lib {
+
+/** Decimal number field with format fixed at compile time
+
+Digits are extracted by subtraction of powers of ten and drawn directly
+as glyphs, without formatting into string. Output is same as
+OStream::dec(value / 10^SCALE, COUNT, DP, PRE)
+
+Template arguments:
+    FONT: font face
+    COUNT: number of digits before decimal point (including sign)
+    DP: number of digits after decimal point
+    SCALE: number of least significant digits of value which are not displayed
+    PRE: precedence character
+*/
+template <const auto &FONT, int COUNT, int DP=0, int SCALE=0, char PRE='\240'>
+class NumberField {
+    static const int DIGITS_MAX = 10;
+
+    static constexpr uint32_t POW10[DIGITS_MAX] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+    };
+
+    static_assert(SCALE + DP < DIGITS_MAX, "Too many digits");
+
+public:
+    /** Draw number
+
+    Arguments:
+        fb: frame buffer
+        x: horizontal position
+        y: vertical position
+        value: number to draw
+
+    Return:
+        horizontal position after number
+    */
+    template <typename FB>
+    static int draw(FB &fb, int x, int y, const int value) {
+        uint32_t u = value < 0 ? -static_cast<uint32_t>(value) : value;
+        const bool neg = value < 0 && u >= POW10[SCALE];
+        int digits = SCALE + DP + 1;
+        while (digits < DIGITS_MAX && u >= POW10[digits]) digits++;
+        int pad = COUNT - (digits - SCALE - DP) - neg;
+        if (neg && PRE == '0') x += fb.draw_char(x, y, '-', FONT);
+        while (pad-- > 0) x += fb.draw_char(x, y, PRE, FONT);
+        if (neg && PRE != '0') x += fb.draw_char(x, y, '-', FONT);
+        for (int d = digits - 1; d >= SCALE; d--) {
+            if (DP && d == SCALE + DP - 1) x += fb.draw_char(x, y, '.', FONT);
+            char digit = '0';
+            while (u >= POW10[d]) {
+                u -= POW10[d];
+                digit++;
+            }
+            x += fb.draw_char(x, y, digit, FONT);
+        }
+        return x;
+    }
+};
+
+}
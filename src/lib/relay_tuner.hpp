@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** Relay feedback (Astrom-Hagglund) PID autotuner
+
+Output is switched between zero and maximum around set point (with
+hysteresis), so process oscillates in limit cycle. From amplitude and
+period of oscillation are found ultimate gain and period, and from them
+PID gains by Tyreus-Luyben rules.
+
+Units of gains are same as arguments of lib::Pid::set_constants():
+p in mW/C, i in mW/(C*s), d in mW*s/C.
+*/
+class RelayTuner {
+public:
+    enum class State {
+        IDLE,
+        RUNNING,
+        DONE,
+        FAILED,
+    };
+
+private:
+    static const int CYCLES_SKIP = 2;  // cycles to settle limit cycle
+    static const int CYCLES_MEASURE = 3;  // cycles averaged for result
+    static const int64_t PI_Q16 = 205887;  // pi in Q16
+
+    State state = State::IDLE;
+    int output_high = 0;  // mW
+    int hysteresis = 0;  // 1/1000 degree C
+    int timeout_ms = 0;
+    bool output_on = false;
+
+    int time_ms = 0;
+    int cycles = 0;  // number of started cycles
+    int cycle_start_ms = 0;
+    int peak_max = 0;
+    int peak_min = 0;
+    int64_t amplitude_sum = 0;  // 1/1000 degree C
+    int period_sum_ms = 0;
+
+    int ultimate_gain = 0;  // mW/C
+    int ultimate_period_ms = 0;
+
+    void cycle_done() {
+        if (cycles > CYCLES_SKIP) {
+            amplitude_sum += (peak_max - peak_min) / 2;
+            period_sum_ms += time_ms - cycle_start_ms;
+        }
+        if (cycles < CYCLES_SKIP + CYCLES_MEASURE) return;
+        int amplitude = amplitude_sum / CYCLES_MEASURE;
+        ultimate_period_ms = period_sum_ms / CYCLES_MEASURE;
+        if (amplitude <= 0 || ultimate_period_ms <= 0) {
+            state = State::FAILED;
+            return;
+        }
+        // Ku = 4 * d / (pi * a), relay amplitude d is half of output_high
+        ultimate_gain = ((int64_t)2 * output_high * 1000 << 16) / (PI_Q16 * amplitude);
+        state = State::DONE;
+    }
+
+public:
+    /** Start relay experiment
+
+    Arguments:
+        high: output when relay is on in mW
+        hyst: hysteresis around set point in 1/1000 degree C
+        timeout: maximum time of experiment in ms
+    */
+    void start(const int high, const int hyst, const int timeout) {
+        output_high = high;
+        hysteresis = hyst;
+        timeout_ms = timeout;
+        output_on = true;
+        time_ms = 0;
+        cycles = 0;
+        amplitude_sum = 0;
+        period_sum_ms = 0;
+        ultimate_gain = 0;
+        ultimate_period_ms = 0;
+        state = State::RUNNING;
+    }
+
+    /** Abort experiment
+    */
+    void stop() {
+        if (state == State::RUNNING) state = State::FAILED;
+    }
+
+    /** Reset to idle state
+    */
+    void reset() {
+        state = State::IDLE;
+    }
+
+    /** Process one step of experiment
+
+    Arguments:
+        feedback: measured value in 1/1000 degree C
+        set_point: required value in 1/1000 degree C
+        period_ms: time from previous step
+
+    Return:
+        requested output in mW
+    */
+    int process(const int feedback, const int set_point, const int period_ms) {
+        if (state != State::RUNNING) return 0;
+        time_ms += period_ms;
+        if (time_ms > timeout_ms) {
+            state = State::FAILED;
+            return 0;
+        }
+        if (feedback > peak_max) peak_max = feedback;
+        if (feedback < peak_min) peak_min = feedback;
+        if (output_on && feedback > set_point + hysteresis) {
+            output_on = false;
+        } else if (!output_on && feedback < set_point - hysteresis) {
+            output_on = true;
+            // one full cycle is from one switch on to another
+            if (cycles) cycle_done();
+            cycles++;
+            cycle_start_ms = time_ms;
+            peak_max = feedback;
+            peak_min = feedback;
+        }
+        if (state != State::RUNNING) return 0;
+        return output_on ? output_high : 0;
+    }
+
+    State get_state() const {
+        return state;
+    }
+
+    bool is_running() const {
+        return state == State::RUNNING;
+    }
+
+    /** Number of finished oscillation cycles */
+    int get_cycles() const {
+        return cycles ? cycles - 1 : 0;
+    }
+
+    static int get_cycles_total() {
+        return CYCLES_SKIP + CYCLES_MEASURE;
+    }
+
+    int get_ultimate_gain() const {
+        return ultimate_gain;
+    }
+
+    int get_ultimate_period_ms() const {
+        return ultimate_period_ms;
+    }
+
+    /** PID gains by Tyreus-Luyben rule
+    (Kp = Ku / 2.2, Ti = 2.2 * Pu, Td = Pu / 6.3), it is more damped than
+    Ziegler-Nichols rule, which overshoot much at heat-up
+
+    Arguments:
+        p: proportional gain in mW/C
+        i: integral gain in mW/(C*s)
+        d: derivative gain in mW*s/C
+    */
+    void get_gains(int &p, int &i, int &d) const {
+        p = ultimate_gain * 10 / 22;
+        i = (int64_t)p * 10000 / (22 * ultimate_period_ms);
+        d = (int64_t)p * ultimate_period_ms / 6300;
+    }
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+namespace lib {
+
+/** Cooperative scheduler of tasks
+
+Each task has period in ticks, task with zero period is processed
+after each wake up. Scheduler tell if any task need to be processed
+again immediately, otherwise CPU can sleep until next interrupt.
+*/
+class Scheduler {
+public:
+    class Task {
+        friend class Scheduler;
+        Task *_next = nullptr;
+        unsigned _period_ticks;
+        unsigned _elapsed_ticks = 0;
+
+    public:
+        Task(unsigned period_ticks) : _period_ticks(period_ticks) {}
+
+        /** Process task
+
+        Arguments:
+            delta_ticks: number of ticks from last run of this task
+
+        Return:
+            true if task need to run again without sleep
+        */
+        virtual bool run(unsigned delta_ticks) = 0;
+    };
+
+    /** Task calling method of object
+    */
+    template <class T, bool (T::*METHOD)(unsigned)>
+    class MethodTask : public Task {
+        T &_object;
+
+    public:
+        MethodTask(T &object, unsigned period_ticks=0) : Task(period_ticks), _object(object) {}
+
+        bool run(unsigned delta_ticks) override {
+            return (_object.*METHOD)(delta_ticks);
+        }
+    };
+
+private:
+    Task *_first = nullptr;
+    Task *_last = nullptr;
+
+public:
+    /** Add task, tasks are processed in order of adding
+
+    Arguments:
+        task: task to add
+    */
+    void add(Task &task) {
+        if (_last) {
+            _last->_next = &task;
+        } else {
+            _first = &task;
+        }
+        _last = &task;
+    }
+
+    /** Process all tasks which reached its period
+
+    Arguments:
+        delta_ticks: number of ticks between each process call
+
+    Return:
+        true if some task need to run again without sleep
+    */
+    bool process(unsigned delta_ticks) {
+        bool busy = false;
+        for (Task *task = _first; task; task = task->_next) {
+            task->_elapsed_ticks += delta_ticks;
+            if (task->_elapsed_ticks < task->_period_ticks) continue;
+            busy |= task->run(task->_elapsed_ticks);
+            task->_elapsed_ticks = 0;
+        }
+        return busy;
+    }
+};
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** Model of power supply as voltage source with internal resistance
+
+Source voltage is supply voltage measured without load, internal
+resistance (supply, cable and connector) is drop of supply voltage
+during heating divided by heater current. Both are filtered by
+exponential moving average, because each heating cycle gives only one
+noisy point.
+
+From model is calculated power which source deliver into heater during
+pulse. Heater is fixed resistance, so supply voltage during pulse is given
+by ratio of resistances for any average power, limiting average power can
+not keep supply voltage higher (this is job of brownout guard).
+*/
+class SupplyModel {
+    static const int FILTER_SHIFT = 3;  // 1/8 of new value each update
+    static const int CURRENT_MIN_MA = 300;  // lower current gives too small drop
+    static const int RESISTANCE_MAX_MO = 20000;  // mOhm, above is measurement error
+    static const int LOAD_RESISTANCE_MAX_MO = 100000;  // mOhm, above is not heater
+
+    int voltage_mv = 0;  // mV, source voltage
+    int resistance_mo = 0;  // mOhm, internal resistance
+    bool valid = false;
+
+public:
+    void reset() {
+        voltage_mv = 0;
+        resistance_mo = 0;
+        valid = false;
+    }
+
+    /** Update model from one heating cycle
+
+    Arguments:
+        voltage_idle_mv: supply voltage without load
+        voltage_heat_mv: supply voltage during heating
+        current_ma: heater current
+
+    Return:
+        true if model was updated
+    */
+    bool update(const int voltage_idle_mv, const int voltage_heat_mv, const int current_ma) {
+        if (current_ma < CURRENT_MIN_MA || voltage_idle_mv <= 0) return false;
+        int drop_mv = voltage_idle_mv - voltage_heat_mv;
+        if (drop_mv < 0) drop_mv = 0;
+        int measured_mo = drop_mv * 1000 / current_ma;
+        if (measured_mo > RESISTANCE_MAX_MO) return false;
+        if (!valid) {
+            voltage_mv = voltage_idle_mv;
+            resistance_mo = measured_mo;
+            valid = true;
+            return true;
+        }
+        voltage_mv += (voltage_idle_mv - voltage_mv) >> FILTER_SHIFT;
+        resistance_mo += (measured_mo - resistance_mo) >> FILTER_SHIFT;
+        return true;
+    }
+
+    bool is_valid() const {
+        return valid;
+    }
+
+    int get_voltage_mv() const {
+        return voltage_mv;
+    }
+
+    int get_resistance_mo() const {
+        return resistance_mo;
+    }
+
+    /** Supply voltage during pulse into load
+
+    Arguments:
+        load_resistance_mo: resistance of heater
+
+    Return:
+        V0 * Rh / (Rh + R) in mV, -1 if model is not valid or load is not heater
+    */
+    int get_load_voltage_mv(const int load_resistance_mo) const {
+        if (!valid || load_resistance_mo <= 0 || load_resistance_mo > LOAD_RESISTANCE_MAX_MO) return -1;
+        // 32 bit is enough for supply below 40 V
+        return (uint32_t)voltage_mv * load_resistance_mo / (load_resistance_mo + resistance_mo);
+    }
+
+    /** Power delivered into load during pulse (highest average power)
+
+    Arguments:
+        load_resistance_mo: resistance of heater
+
+    Return:
+        power in mW, -1 if model is not valid or load is not heater
+    */
+    int get_load_power_mw(const int load_resistance_mo) const {
+        int load_voltage_mv = get_load_voltage_mv(load_resistance_mo);
+        if (load_voltage_mv < 0) return -1;
+        // square of voltage below 65 V fit into 32 bit
+        return (uint32_t)load_voltage_mv * load_voltage_mv / load_resistance_mo;
+    }
+};
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lib {
+
+/** Kalman filter of temperature over lumped thermal model
+
+Model has one heat capacity heated by delivered energy and cooled to
+ambient through thermal resistance. Estimate is predicted by heat()
+after each heating pulse and by cool() after each period, measurement
+from thermocouple is fused by update(). Between measurements estimate
+follows the model, so temperature is known also during heating.
+
+Model is computed in fixed point (Q format), only update() use
+division (once per period).
+*/
+class TemperatureEstimator {
+    static const int ENERGY_SHIFT = 16;  // energy is scaled before multiplication
+    static const int Q_ENERGY = 32;  // fractional bits of energy coefficient
+    static const int Q_LOSS = 48;  // fractional bits of inverse time constant
+    static const int Q_GAIN = 16;  // fractional bits of Kalman gain
+    static const int64_t VARIANCE_MAX = (int64_t)100000 * 100000;  // (100 degree C)^2
+
+    int64_t _energy_coef_q = 0;  // 1/1000 degree C per (uW * tick >> ENERGY_SHIFT)
+    int64_t _inverse_time_constant_q = 0;  // 1 / (R * C) per tick
+    int64_t _process_variance = 0;  // (1/1000 degree C)^2 per period
+    int64_t _measurement_variance = 0;  // (1/1000 degree C)^2
+
+    int _temperature_mc = 0;
+    int64_t _variance = 0;  // (1/1000 degree C)^2
+    bool _valid = false;
+
+public:
+    /** Set model constants
+
+    Arguments:
+        heat_capacity_mjk: heat capacity in mJ/K
+        thermal_resistance_mkw: thermal resistance to ambient in mK/W
+        freq: ticks per second
+        process_noise_mc: standard deviation of model error per period in 1/1000 degree C
+        measurement_noise_mc: standard deviation of measurement in 1/1000 degree C
+    */
+    void set_constants(const int heat_capacity_mjk, const int thermal_resistance_mkw, const unsigned freq, const int process_noise_mc, const int measurement_noise_mc) {
+        // dT[mC] = E[uW * tick] / (freq * C[mJ/K])
+        _energy_coef_q = ((int64_t)1 << (Q_ENERGY + ENERGY_SHIFT)) / ((int64_t)freq * heat_capacity_mjk);
+        // tau[tick] = R[mK/W] * C[mJ/K] * freq / 1e6
+        _inverse_time_constant_q = (((int64_t)1 << Q_LOSS) / ((int64_t)thermal_resistance_mkw * heat_capacity_mjk)) * 1000000 / freq;
+        _process_variance = (int64_t)process_noise_mc * process_noise_mc;
+        _measurement_variance = (int64_t)measurement_noise_mc * measurement_noise_mc;
+        reset();
+    }
+
+    /** Forget estimate, next measurement initialize it
+    */
+    void reset() {
+        _valid = false;
+        _variance = VARIANCE_MAX;
+    }
+
+    /** Predict heating by delivered energy
+
+    Arguments:
+        energy_uwt: delivered energy in uW * tick
+    */
+    void heat(const int64_t energy_uwt) {
+        if (!_valid) return;
+        _temperature_mc += ((energy_uwt >> ENERGY_SHIFT) * _energy_coef_q) >> Q_ENERGY;
+    }
+
+    /** Predict cooling to ambient
+
+    Arguments:
+        ticks: elapsed time in ticks
+        ambient_mc: ambient temperature in 1/1000 degree C
+    */
+    void cool(const unsigned ticks, const int ambient_mc) {
+        if (!_valid) return;
+        _temperature_mc -= ((int64_t)(_temperature_mc - ambient_mc) * ticks * _inverse_time_constant_q) >> Q_LOSS;
+        _variance += _process_variance;
+        if (_variance > VARIANCE_MAX) _variance = VARIANCE_MAX;
+    }
+
+    /** Fuse measurement into estimate
+
+    Arguments:
+        measured_mc: measured temperature in 1/1000 degree C
+    */
+    void update(const int measured_mc) {
+        if (!_valid) {
+            _temperature_mc = measured_mc;
+            _variance = _measurement_variance;
+            _valid = true;
+            return;
+        }
+        int64_t gain_q = (_variance << Q_GAIN) / (_variance + _measurement_variance);
+        _temperature_mc += ((int64_t)(measured_mc - _temperature_mc) * gain_q) >> Q_GAIN;
+        _variance -= (_variance * gain_q) >> Q_GAIN;
+    }
+
+    bool is_valid() const {
+        return _valid;
+    }
+
+    int get_temperature_mc() const {
+        return _temperature_mc;
+    }
+};
+
+}
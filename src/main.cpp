@@ -5,22 +5,45 @@
 #include "board/i2c.hpp"
 #include "board/buttons.hpp"
 #include "board/display.hpp"
+#include "lib/scheduler.hpp"
 #include "heating.hpp"
+#include "settings.hpp"
+#include "trace.hpp"
+#include "profiler.hpp"
 #include "display.hpp"
 
 class MainClass {
+    static const unsigned TRACE_DRAIN_TICKS = board::Clock::CORE_FREQ / 1000 * 10;  // ticks
+    static const unsigned PROFILER_SEND_TICKS = board::Clock::CORE_FREQ;  // ticks
+
     unsigned last_ticks = 0;
 
     Heating _heating;
     Display _display;
+    Settings _settings;
 
-    void _process(unsigned delta_ticks) {
-        _display.process(delta_ticks);
-        if (_heating.process(delta_ticks)) return;
-        _display.draw();
+    bool _process_heating(unsigned delta_ticks) {
+        {
+            Profiler::Scope scope(Profiler::Probe::HEATING_PROCESS);
+            if (_heating.process(delta_ticks)) return false;
+        }
+        {
+            Profiler::Scope scope(Profiler::Probe::DISPLAY_DRAW);
+            _display.draw();
+        }
         _heating.start();
+        // start of heating is processed immediately
+        return true;
     }
 
+    lib::Scheduler _scheduler;
+    lib::Scheduler::MethodTask<MainClass, &MainClass::_process_heating> _task_heating;
+    lib::Scheduler::MethodTask<Display, &Display::process> _task_buttons;
+    lib::Scheduler::MethodTask<Display, &Display::refresh> _task_display;
+    lib::Scheduler::MethodTask<Trace, &Trace::drain> _task_trace;
+    lib::Scheduler::MethodTask<Profiler, &Profiler::send> _task_profiler;
+    lib::Scheduler::MethodTask<Settings, &Settings::process> _task_settings;
+
     void _init_hw() {
         board::clock.init_hw();
         board::systick.init_hw();
@@ -33,24 +56,45 @@ class MainClass {
     }
 
 public:
-    MainClass() : _display(_heating) {}
+    MainClass() :
+        _display(_heating),
+        _settings(_heating),
+        _task_heating(*this),
+        _task_buttons(_display, Display::BUTTONS_SAMPLE_TICKS),
+        _task_display(_display),
+        _task_trace(trace, TRACE_DRAIN_TICKS),
+        _task_profiler(profiler, PROFILER_SEND_TICKS),
+        _task_settings(_settings, Settings::PROCESS_TICKS) {
+        _scheduler.add(_task_heating);
+        _scheduler.add(_task_buttons);
+        _scheduler.add(_task_display);
+        _scheduler.add(_task_trace);
+        _scheduler.add(_task_profiler);
+        _scheduler.add(_task_settings);
+    }
 
     void run() {
         _init_hw();
         io::Nvic::isr_enable();
 
         board::display.init();
+#ifdef TRACE_ENABLED
+        trace.enable();
+#endif
         _heating.init();
+        _settings.load();
         _heating.start();
 
-        board::debug.dbg << lib::IOStream::endl;
         last_ticks = board::systick.get_counter();
 
         while (true) {
             unsigned delta_ticks = last_ticks;
             last_ticks = board::systick.get_counter();
             delta_ticks = ((1 << board::Systick::DIV_BITS) - 1) & (delta_ticks - last_ticks);
-            _process(delta_ticks);
+            // CPU sleeps until interrupt, heating cycle always wait for ADC
+            // measurement, which wake up CPU after each half of DMA buffer,
+            // so time events are not missed
+            if (!_scheduler.process(delta_ticks)) board::clock.sleep();
         }
     }
 };
@@ -1,8 +1,10 @@
 #pragma once
 
 class Preset {
-
+public:
     static const int PRESETS = 2;
+
+private:
     static const int NO_EDIT = -1;
 
     // temperatures are in 1/1000 degree C
@@ -86,6 +88,19 @@ public:
         return _temperatures[preset];
     }
 
+    /** Set preset temperature (restored from settings)
+
+    Arguments:
+        preset: preset number
+        temperature: temperature in 1/1000 degree C
+    */
+    void set_preset(int preset, int temperature) {
+        if ((preset < 0) || (preset >= PRESETS)) return;
+        if (temperature < PRESET_TEMPERATURE_MIN) temperature = PRESET_TEMPERATURE_MIN;
+        if (temperature > PRESET_TEMPERATURE_MAX) temperature = PRESET_TEMPERATURE_MAX;
+        _temperatures[preset] = temperature;
+    }
+
     /** Read selected preset
 
     Return:
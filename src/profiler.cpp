@@ -0,0 +1,3 @@
+#include "profiler.hpp"
+
+Profiler profiler;
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include "io/reg/cortexm/nvic.hpp"
+#include "board/systick.hpp"
+#include "board/debug.hpp"
+#include "telemetry.hpp"
+
+/** Cycle profiler of code sections
+
+Duration of section is measured by Systick counter in CPU ticks,
+for each probe is counted number of runs, minimum, maximum, mean
+and histogram with log2 buckets (bucket N counts durations from 2^N to 2^(N+1) - 1).
+Duration include time spent in interrupts.
+Statistics are cumulated from start, shown on screen::Info and sent
+by send() as telemetry frames of type PROFILE, mean is updated by send().
+*/
+class Profiler {
+public:
+    enum class Probe : uint8_t {
+        HEATING_PROCESS,  // Heating::process()
+        DISPLAY_DRAW,  // Display::draw()
+        ADC_MEASURE,  // Heating::adc_measure_done() (ADC interrupt)
+        PID_PROCESS,  // Pid::process() or FixedPid::process()
+        COUNT,
+    };
+
+    static const int HISTOGRAM_SIZE = 16;
+    static const int PAYLOAD_SIZE = 1 + 4 * 4 + HISTOGRAM_SIZE * 2;
+    static_assert(PAYLOAD_SIZE <= Telemetry::PAYLOAD_SIZE_MAX, "Too big payload");
+
+    struct Stats {
+        uint32_t count = 0;
+        uint32_t min = UINT32_MAX;
+        uint32_t max = 0;
+        uint64_t sum = 0;
+        uint32_t mean = 0;  // updated by Profiler::send(), not by each record
+        uint16_t histogram[HISTOGRAM_SIZE] = {0};
+
+        uint32_t get_mean() const {
+            return mean;
+        }
+    };
+
+    /** Measure duration of scope
+    */
+    class Scope {
+        const Probe _probe;
+        const uint32_t _start;
+
+    public:
+        Scope(const Probe probe) : _probe(probe), _start(board::systick.get_counter()) {}
+
+        ~Scope();
+    };
+
+private:
+    Stats _stats[static_cast<int>(Probe::COUNT)];
+
+public:
+    /** Add measured duration to statistics
+
+    Arguments:
+        probe: probe
+        ticks: duration in CPU ticks
+    */
+    void record(const Probe probe, const uint32_t ticks) {
+        Stats &stats = _stats[static_cast<int>(probe)];
+        stats.count++;
+        if (stats.min > ticks) stats.min = ticks;
+        if (stats.max < ticks) stats.max = ticks;
+        stats.sum += ticks;
+        int bucket = 0;
+        while (bucket < HISTOGRAM_SIZE - 1 && (ticks >> (bucket + 1))) bucket++;
+        if (stats.histogram[bucket] < UINT16_MAX) stats.histogram[bucket]++;
+    }
+
+    const Stats &get_stats(const Probe probe) const {
+        return _stats[static_cast<int>(probe)];
+    }
+
+    /** Send statistics of all probes over debug UART
+    (called from main loop, probe ADC_MEASURE is recorded in interrupt,
+    so statistics are copied with interrupts disabled, 64-bit sum is not
+    read atomically)
+
+    Arguments:
+        delta_ticks: not used
+
+    Return:
+        false, profiler does not need to run again without sleep
+    */
+    bool send(unsigned) {
+        for (int i = 0; i < static_cast<int>(Probe::COUNT); i++) {
+            io::Nvic::isr_disable();
+            Stats stats = _stats[i];
+            io::Nvic::isr_enable();
+            // 64-bit division once per send, not in each frame of screen::Info
+            // (mean is written only here, so it is not overwritten by interrupt)
+            stats.mean = stats.count ? stats.sum / stats.count : 0;
+            _stats[i].mean = stats.mean;
+            if (board::debug.uart.get_tx_free() < Telemetry::FRAME_SIZE_MAX) continue;
+            uint8_t payload[PAYLOAD_SIZE];
+            uint8_t *ptr = payload;
+            *ptr++ = i;
+            ptr = Telemetry::write_u32(ptr, stats.count);
+            ptr = Telemetry::write_u32(ptr, stats.count ? stats.min : 0);
+            ptr = Telemetry::write_u32(ptr, stats.max);
+            ptr = Telemetry::write_u32(ptr, stats.get_mean());
+            for (const uint16_t value : stats.histogram) {
+                *ptr++ = value;
+                *ptr++ = value >> 8;
+            }
+            uint8_t frame[Telemetry::FRAME_SIZE_MAX];
+            int size = Telemetry::encode(Telemetry::Type::PROFILE, payload, PAYLOAD_SIZE, frame);
+            board::debug.uart.write_data(reinterpret_cast<char *>(frame), size);
+        }
+        return false;
+    }
+};
+
+extern Profiler profiler;
+
+inline Profiler::Scope::~Scope() {
+    // Systick counter is countdown with DIV_BITS
+    profiler.record(_probe, ((1 << board::Systick::DIV_BITS) - 1) & (_start - board::systick.get_counter()));
+}
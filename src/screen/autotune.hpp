@@ -0,0 +1,134 @@
+#pragma once
+
+#include "screen/screen.hpp"
+#include "lib/font.hpp"
+#include "lib/stringstream.hpp"
+#include "lib/relay_tuner.hpp"
+#include "preset.hpp"
+#include "heating.hpp"
+#include "tips.hpp"
+
+namespace screen {
+
+/** PID autotune of inserted tip
+
+UP start autotune at selected preset, DW abort it,
+both buttons return to main screen, long press of both buttons open
+calibration screen.
+*/
+class Autotune : public Screen {
+
+    board::Display::Fb &_fb = board::display.get_fb();
+    Heating &_heating;
+    Preset &_preset;
+
+    void _draw_line(int line, const char *text, const char *value=nullptr) {
+        _fb.draw_text(0, line * 11, text, lib::Font::sans8);
+        if (value) {
+            int w = lib::Font::text_width(value, lib::Font::sans8);
+            _fb.draw_text(128 - w, line * 11, value, lib::Font::sans8);
+        }
+    }
+
+    void _draw_title() {
+        lib::StringStream<16> ss;
+        ss.reset().dec(_heating.get_real_pen_temperature_mc() / 100, 3, 1, '\240').s(" \260C");
+        _draw_line(0, "PID autotune", ss.get_str());
+    }
+
+    void _draw_status() {
+        lib::StringStream<16> ss;
+        const lib::RelayTuner &tuner = _heating.get_autotune();
+        switch (tuner.get_state()) {
+            case lib::RelayTuner::State::RUNNING:
+                ss.reset().i(tuner.get_cycles()).c('/').i(lib::RelayTuner::get_cycles_total());
+                _draw_line(1, "Cycle: ", ss.get_str());
+                break;
+            case lib::RelayTuner::State::DONE:
+                ss.reset().dec(tuner.get_ultimate_period_ms() / 10, 2, 2).s(" s");
+                _draw_line(1, "Done, period: ", ss.get_str());
+                break;
+            case lib::RelayTuner::State::FAILED:
+                _draw_line(1, "Failed");
+                break;
+            default:
+                _draw_line(1, "UP: start DW: stop");
+                break;
+        }
+    }
+
+    void _draw_gains() {
+        lib::StringStream<20> ss;
+        Tips &tips = _heating.get_tips();
+        const Tips::Profile *profile = tips.get_active();
+        if (!profile) {
+            _draw_line(2, "No RT tip");
+            return;
+        }
+        if (!profile->is_tuned()) {
+            ss.reset().s("Tip ").i(tips.get_active_index() + 1).s(": default");
+            _draw_line(2, ss.get_str());
+            return;
+        }
+        ss.reset().i(profile->pid_p).c(' ').i(profile->pid_i).c(' ').i(profile->pid_d);
+        lib::StringStream<8> tip;
+        tip.reset().s("Tip ").i(tips.get_active_index() + 1);
+        _draw_line(2, tip.get_str(), ss.get_str());
+    }
+
+public:
+
+    Autotune(ScreenHolder &screen_holder, Heating &heating) :
+        Screen(screen_holder),
+        _heating(heating),
+        _preset(heating.get_preset()) {}
+
+    bool button_up(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+                if (_heating.get_autotune().is_running()) break;
+                _preset.select(_preset.get_selected());
+                _heating.autotune_start();
+                break;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    bool button_dw(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+                _heating.autotune_stop();
+                break;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    bool button_both(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+                _heating.autotune_stop();
+                change_screen(ScreenId::MAIN);
+                return true;
+            case lib::Button::Action::PRESSED_LONG:
+                _heating.autotune_stop();
+                change_screen(ScreenId::CALIBRATION);
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    void draw() override {
+        _draw_title();
+        _draw_status();
+        _draw_gains();
+    }
+
+};
+
+}
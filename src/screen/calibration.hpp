@@ -0,0 +1,139 @@
+#pragma once
+
+#include "screen/screen.hpp"
+#include "lib/font.hpp"
+#include "lib/stringstream.hpp"
+#include "preset.hpp"
+#include "heating.hpp"
+#include "tips.hpp"
+
+namespace screen {
+
+/** Thermocouple calibration of inserted tip
+
+Tip is heated to selected preset, UP and DW set temperature measured by
+reference thermometer, long press of both buttons store calibration
+point (first point correct offset, second one also gain), both buttons
+return to main screen.
+*/
+class Calibration : public Screen {
+
+    static const int REFERENCE_STEP_MC = 1000;  // 1/1000 degree C
+    static const int REFERENCE_MIN_MC = 100 * 1000;  // 1/1000 degree C
+    static const int REFERENCE_MAX_MC = 450 * 1000;  // 1/1000 degree C
+
+    board::Display::Fb &_fb = board::display.get_fb();
+    Heating &_heating;
+    Preset &_preset;
+    int _reference_mc = 0;  // 1/1000 degree C, 0 before first use
+    int _points = 0;  // result of last calibration
+
+    void _draw_line(int line, const char *text, const char *value=nullptr) {
+        _fb.draw_text(0, line * 11, text, lib::Font::sans8);
+        if (value) {
+            int w = lib::Font::text_width(value, lib::Font::sans8);
+            _fb.draw_text(128 - w, line * 11, value, lib::Font::sans8);
+        }
+    }
+
+    void _draw_title() {
+        lib::StringStream<16> ss;
+        ss.reset().dec(_heating.get_real_pen_temperature_mc() / 100, 3, 1, '\240').s(" \260C");
+        _draw_line(0, "Calibration", ss.get_str());
+    }
+
+    void _draw_reference() {
+        lib::StringStream<16> ss;
+        if (!_reference_mc) _set_reference(_preset.get_temperature());
+        ss.reset().i(_reference_mc / 1000).s(" \260C");
+        _draw_line(1, _points ? "Stored: " : "Reference: ", ss.get_str());
+    }
+
+    void _draw_profile() {
+        lib::StringStream<20> ss;
+        Tips &tips = _heating.get_tips();
+        const Tips::Profile *profile = tips.get_active();
+        if (!profile) {
+            _draw_line(2, "No RT tip");
+            return;
+        }
+        lib::StringStream<8> tip;
+        tip.reset().s("Tip ").i(tips.get_active_index() + 1);
+        if (!profile->is_calibrated()) {
+            _draw_line(2, tip.get_str(), "default");
+            return;
+        }
+        int gain = ((int64_t)profile->get_temperature_gain() * 1000) >> board::Adc::PEN_GAIN_Q;
+        ss.reset().dec(profile->temperature_offset_mc / 100, 1, 1).s(" \260C ").dec(gain, 1, 3);
+        _draw_line(2, tip.get_str(), ss.get_str());
+    }
+
+    void _set_reference(int reference_mc) {
+        if (reference_mc < REFERENCE_MIN_MC) reference_mc = REFERENCE_MIN_MC;
+        if (reference_mc > REFERENCE_MAX_MC) reference_mc = REFERENCE_MAX_MC;
+        _reference_mc = reference_mc;
+    }
+
+    void _change_reference(const int delta_mc) {
+        _set_reference(_reference_mc + delta_mc);
+        _points = 0;
+    }
+
+public:
+
+    Calibration(ScreenHolder &screen_holder, Heating &heating) :
+        Screen(screen_holder),
+        _heating(heating),
+        _preset(heating.get_preset()) {}
+
+    bool button_up(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+            case lib::Button::Action::PRESSED_LONG:
+            case lib::Button::Action::REPEAT:
+                _change_reference(REFERENCE_STEP_MC);
+                break;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    bool button_dw(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+            case lib::Button::Action::PRESSED_LONG:
+            case lib::Button::Action::REPEAT:
+                _change_reference(-REFERENCE_STEP_MC);
+                break;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    bool button_both(const lib::Button::Action action) override {
+        switch (action) {
+            case lib::Button::Action::RELEASED_SHORT:
+                _reference_mc = 0;
+                _points = 0;
+                change_screen(ScreenId::MAIN);
+                return true;
+            case lib::Button::Action::PRESSED_LONG:
+                _points = _heating.calibrate_tip(_reference_mc);
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    void draw() override {
+        _draw_title();
+        _draw_reference();
+        _draw_profile();
+    }
+
+};
+
+}
@@ -6,6 +6,7 @@
 #include "preset.hpp"
 #include "heating.hpp"
 #include "meta.hpp"
+#include "profiler.hpp"
 
 namespace screen {
 
@@ -29,7 +30,7 @@ class Info : public Screen {
     int last_line = 0;
 
     void _draw_state() {
-        lib::StringStream<10> ss;
+        lib::StringStream<16> ss;
         int line = 0;
 
         _draw_line(line++, Meta::project, Meta::version);
@@ -61,6 +62,18 @@ class Info : public Screen {
         ss.reset().dec(_heating.get_supply_voltage_mv_drop() / 10, 2, 2, '\240').s(" V");
         _draw_line(line++, "Supply drop: ", ss.get_str());
 
+        ss.reset().dec(_heating.get_supply_resistance_mo() / 10, 2, 2, '\240').s(" Ohm");
+        _draw_line(line++, "Supply res: ", ss.get_str());
+
+        ss.reset().dec(_heating.get_power_limit_mw() / 10, 2, 2, '\240').s(" W");
+        _draw_line(line++, "Power limit: ", ss.get_str());
+
+        ss.reset().dec(_heating.get_brownout().get_limit_mv() / 10, 2, 2, '\240').s(" V");
+        _draw_line(line++, "Brownout limit: ", ss.get_str());
+
+        ss.reset().i(_heating.get_brownout().get_cuts(), 3, '\240');
+        _draw_line(line++, "Brownout cuts: ", ss.get_str());
+
         ss.reset().dec(_heating.get_cpu_voltage_mv_idle() / 10, 2, 2, '\240').s(" V");
         _draw_line(line++, "CPU idle: ", ss.get_str());
 
@@ -73,6 +86,19 @@ class Info : public Screen {
         ss.reset().i(_heating.get_steady_ms() / 1000, 3, '\240').s(" s");
         _draw_line(line++, "Steady timer: ", ss.get_str());
 
+        static const char *const PROBE_NAMES[] = {
+            "Heating: ",
+            "Draw: ",
+            "ADC irq: ",
+            "PID: ",
+        };
+        _draw_line(line++, "Profile ticks: ", "mean/max");
+        for (int i = 0; i < static_cast<int>(Profiler::Probe::COUNT); i++) {
+            const Profiler::Stats &stats = profiler.get_stats(static_cast<Profiler::Probe>(i));
+            ss.reset().u(stats.get_mean()).c('/').u(stats.max);
+            _draw_line(line++, PROBE_NAMES[i], ss.get_str());
+        }
+
         last_line = line;
     }
 
@@ -114,8 +140,8 @@ public:
                 change_screen(ScreenId::MAIN);
                 return true;
             case lib::Button::Action::PRESSED_LONG:
-                // enter MENU
-                break;
+                change_screen(ScreenId::AUTOTUNE);
+                return true;
             default:
                 break;
         }
@@ -2,7 +2,7 @@
 
 #include "screen/screen.hpp"
 #include "lib/font.hpp"
-#include "lib/stringstream.hpp"
+#include "lib/numberfield.hpp"
 #include "preset.hpp"
 #include "heating.hpp"
 
@@ -23,66 +23,54 @@ class Main : public Screen {
     }
 
     /** display temperature in 1/1000 degree Celsius */
-    template<class Tfl, class Tfs>
-    void _temperature(int x, int y, int temperature, const Tfl font_large, const Tfs font_small) {
-        lib::StringStream<4> ss;
-        ss.i(temperature / 1000, 3, '\240');
-        x = _fb.draw_text(x, y, ss.get_str(), font_large);
-        _fb.draw_text(x, y, "\260C", font_small);
+    template <const auto &FONT_LARGE, const auto &FONT_SMALL>
+    void _temperature(int x, int y, int temperature) {
+        x = lib::NumberField<FONT_LARGE, 3, 0, 3>::draw(_fb, x, y, temperature);
+        _fb.draw_text(x, y, "\260C", FONT_SMALL);
     }
 
     /** display voltage in millivolts */
     void _voltage_mv(int x, int y, int voltage_mv) {
-        lib::StringStream<5> ss;
         if (voltage_mv < 10 * 1000) {
-            ss.dec(voltage_mv / 10, 1, 2, '\240');
+            x = lib::NumberField<lib::Font::num7, 1, 2, 1>::draw(_fb, x, y, voltage_mv);
         } else {
-            ss.dec(voltage_mv / 100, 2, 1, '\240');
+            x = lib::NumberField<lib::Font::num7, 2, 1, 2>::draw(_fb, x, y, voltage_mv);
         }
-        x = _fb.draw_text(x, y, ss.get_str(), lib::Font::num7);
         _fb.draw_char(x, y, 'V', lib::Font::sans8);
     }
 
     /** display drop voltage in millivolts */
     void _drop_voltage_mv(int x, int y, int voltage_mv) {
-        lib::StringStream<6> ss;
-        ss.dec(voltage_mv / 10, 2, 2, '\240');
-        x = _fb.draw_text(x, y, ss.get_str(), lib::Font::num7);
+        x = lib::NumberField<lib::Font::num7, 2, 2, 1>::draw(_fb, x, y, voltage_mv);
         _fb.draw_char(x, y, 'V', lib::Font::sans8);
     }
 
     /** display current in mA */
     void _current_ma(int x, int y, int current_ma) {
-        lib::StringStream<7> ss;
-        ss.dec(current_ma, 2, 3, '\240');
-        x = _fb.draw_text(x, y, ss.get_str(), lib::Font::num7);
+        x = lib::NumberField<lib::Font::num7, 2, 3>::draw(_fb, x, y, current_ma);
         _fb.draw_char(x, y, 'A', lib::Font::sans8);
     }
 
     /** display power in milliwatts */
     void _watts_mw(int x, int y, int watts_mw) {
-        lib::StringStream<5> ss;
-        ss.dec(watts_mw / 100, 2, 1, '\240');
-        x = _fb.draw_text(x, y, ss.get_str(), lib::Font::num7);
+        x = lib::NumberField<lib::Font::num7, 2, 1, 2>::draw(_fb, x, y, watts_mw);
         _fb.draw_char(x, y, 'W', lib::Font::sans8);
     }
 
     /** display power in milliwatts */
     void _energy(int x, int y, int energy_mwh) {
-        lib::StringStream<5> ss;
         if (energy_mwh < 100000) {
-            ss.dec(energy_mwh / 10, 2, 2, '\240');
+            x = lib::NumberField<lib::Font::num7, 2, 2, 1>::draw(_fb, x, y, energy_mwh);
         } else {
-            ss.dec(energy_mwh / 100, 3, 1, '\240');
+            x = lib::NumberField<lib::Font::num7, 3, 1, 2>::draw(_fb, x, y, energy_mwh);
         }
-        x = _fb.draw_text(x, y, ss.get_str(), lib::Font::num7);
         _fb.draw_text(x, y, "Wh", lib::Font::sans8);
     }
 
     int _edit_blink = 0;
 
     void _draw_pen_temperature() {
-        _temperature(48, 10, _heating.get_real_pen_temperature_mc() + 500, lib::Font::num22, lib::Font::num9);
+        _temperature<lib::Font::num22, lib::Font::num9>(48, 10, _heating.get_real_pen_temperature_mc() + 500);
     }
 
     void _draw_preset() {
@@ -90,10 +78,10 @@ class Main : public Screen {
         if (_preset.get_selected() == 0) _preset_selected(0, 0, !_preset.is_standby());
         if (_preset.get_selected() == 1) _preset_selected(0, 19, !_preset.is_standby());
         if (!_preset.is_editing(0) || _edit_blink < 5) {
-            _temperature(6, 0, _preset.get_preset(0), lib::Font::num13, lib::Font::num7);
+            _temperature<lib::Font::num13, lib::Font::num7>(6, 0, _preset.get_preset(0));
         }
         if (!_preset.is_editing(1) || _edit_blink < 5) {
-            _temperature(6, 19, _preset.get_preset(1), lib::Font::num13, lib::Font::num7);
+            _temperature<lib::Font::num13, lib::Font::num7>(6, 19, _preset.get_preset(1));
         }
     }
 
@@ -112,6 +100,10 @@ class Main : public Screen {
     void _draw_state() {
         if (status_blink++ >= 6) status_blink = 0;
         if (_preset.is_standby()) {
+            if (_heating.get_brownout().is_supply_insufficient()) {
+                _fb.draw_text(67, 0, "LOW SUPPLY!", lib::Font::sans8);
+                return;  // do not show energy
+            }
             if (_heating.getPenSensorStatus() == Heating::PenSensorStatus::OK) {
                 if (_heating.getHeatingElementStatus() == Heating::HeatingElementStatus::BROKEN) {
                     _fb.draw_text(55, 0, "BROKEN RT TIP!", lib::Font::sans8);
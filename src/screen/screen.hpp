@@ -7,6 +7,8 @@ class Screen;
 enum class ScreenId {
     MAIN,
     INFO,
+    AUTOTUNE,
+    CALIBRATION,
     COUNT,
 };
 
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "board/clock.hpp"
+#include "board/flash.hpp"
+#include "lib/kv_store.hpp"
+#include "heating.hpp"
+#include "preset.hpp"
+#include "tips.hpp"
+
+/** Persistent settings
+
+Preset temperatures, tip profiles (with calibration) and total energy
+are kept in lib::KvStore in last pages of flash. Values are restored at
+boot and are written back in batch, when pen is in standby for
+SAVE_DELAY_MS, because flash erase stall CPU.
+*/
+class Settings {
+public:
+    static const unsigned PROCESS_TICKS = board::Clock::CORE_FREQ / 10;  // ticks
+
+private:
+    static const int SAVE_DELAY_MS = 3000;  // ms
+    static const int TIP_FIELDS = 4;  // resistance, pid_p, pid_i, pid_d
+    static const int TIP_CALIBRATION_FIELDS = 2;  // temperature_offset_mc, temperature_gain
+
+    enum Key {
+        PRESET = 0,  // temperature of each preset
+        ENERGY_MWH = PRESET + Preset::PRESETS,
+        TIP = ENERGY_MWH + 1,  // TIP_FIELDS values of each tip profile
+        TIP_CALIBRATION = TIP + Tips::PROFILES * TIP_FIELDS,  // TIP_CALIBRATION_FIELDS of each tip
+        COUNT = TIP_CALIBRATION + Tips::PROFILES * TIP_CALIBRATION_FIELDS,
+    };
+
+    Heating &_heating;
+    lib::KvStore<board::Flash, Key::COUNT> _store;
+    unsigned _standby_ticks = 0;
+
+    void _get(const int key, int &value) {
+        uint32_t stored;
+        if (_store.get(key, stored)) value = stored;
+    }
+
+    /** Copy actual values into RAM shadow of store
+    */
+    void _update() {
+        Preset &preset = _heating.get_preset();
+        for (int i = 0; i < Preset::PRESETS; i++) {
+            _store.set(PRESET + i, preset.get_preset(i));
+        }
+        _store.set(ENERGY_MWH, _heating.get_energy_mwh());
+        Tips &tips = _heating.get_tips();
+        for (int i = 0; i < Tips::PROFILES; i++) {
+            const Tips::Profile &profile = tips.get_profile(i);
+            int key = TIP + i * TIP_FIELDS;
+            _store.set(key++, profile.resistance_mo);
+            _store.set(key++, profile.pid_p);
+            _store.set(key++, profile.pid_i);
+            _store.set(key++, profile.pid_d);
+            key = TIP_CALIBRATION + i * TIP_CALIBRATION_FIELDS;
+            _store.set(key++, profile.temperature_offset_mc);
+            _store.set(key++, profile.temperature_gain);
+        }
+    }
+
+public:
+    Settings(Heating &heating) :
+        _heating(heating),
+        _store(board::flash) {}
+
+    /** Restore settings
+    (one pass over log in flash, without any erase or write)
+    */
+    void load() {
+        _store.load();
+        Preset &preset = _heating.get_preset();
+        for (int i = 0; i < Preset::PRESETS; i++) {
+            int temperature = preset.get_preset(i);
+            _get(PRESET + i, temperature);
+            preset.set_preset(i, temperature);
+        }
+        uint32_t energy_mwh;
+        if (_store.get(ENERGY_MWH, energy_mwh)) _heating.set_energy_mwh(energy_mwh);
+        Tips &tips = _heating.get_tips();
+        for (int i = 0; i < Tips::PROFILES; i++) {
+            Tips::Profile &profile = tips.get_profile(i);
+            int key = TIP + i * TIP_FIELDS;
+            _get(key++, profile.resistance_mo);
+            _get(key++, profile.pid_p);
+            _get(key++, profile.pid_i);
+            _get(key++, profile.pid_d);
+            key = TIP_CALIBRATION + i * TIP_CALIBRATION_FIELDS;
+            _get(key++, profile.temperature_offset_mc);
+            _get(key++, profile.temperature_gain);
+        }
+    }
+
+    /** Save changed settings in standby
+
+    Arguments:
+        delta_ticks: ticks from last call
+
+    Return:
+        false, flash is written synchronously
+    */
+    bool process(unsigned delta_ticks) {
+        Preset &preset = _heating.get_preset();
+        if (!preset.is_standby() || preset.is_editing()) {
+            _standby_ticks = 0;
+            return false;
+        }
+        _update();
+        if (!_store.is_dirty()) return false;
+        _standby_ticks += delta_ticks;
+        if (_standby_ticks < SAVE_DELAY_MS * (board::Clock::CORE_FREQ / 1000)) return false;
+        // failed write is repeated after next delay
+        _store.flush();
+        _standby_ticks = 0;
+        return false;
+    }
+};
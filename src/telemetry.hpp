@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include "lib/cobs.hpp"
+#include "lib/crc16.hpp"
+
+/** Binary telemetry frames
+
+Frame contain type, payload and CRC-16 of type and payload, whole frame
+is COBS encoded and terminated by zero delimiter. All numbers are
+little endian. Frames are decoded on host by sim/decode.cpp.
+*/
+class Telemetry {
+public:
+    enum class Type : uint8_t {
+        CONTROL = 1,  // Telemetry::Control
+        TRACE = 2,  // record of Trace
+        PROFILE = 3,  // statistics of one Profiler probe
+    };
+
+    /** State of heating in one control step
+    */
+    struct Control {
+        static const int SIZE = 14 * 4;
+
+        uint32_t ticks;
+        int32_t pen_temperature_mc;
+        int32_t set_point_mc;
+        int32_t cpu_temperature_mc;
+        int32_t requested_power_mw;
+        int32_t power_mw;
+        int32_t supply_voltage_mv_idle;
+        int32_t supply_voltage_mv_heat;
+        int32_t pen_current_ma;
+        int32_t pen_resistance_mo;
+        int32_t pid_p;
+        int32_t pid_i;
+        int32_t pid_d;
+        int32_t estimated_temperature_mc;  // model prediction before last measurement
+
+        void pack(uint8_t *ptr) const {
+            const int32_t values[] = {
+                (int32_t)ticks, pen_temperature_mc, set_point_mc, cpu_temperature_mc,
+                requested_power_mw, power_mw, supply_voltage_mv_idle, supply_voltage_mv_heat,
+                pen_current_ma, pen_resistance_mo, pid_p, pid_i, pid_d,
+                estimated_temperature_mc,
+            };
+            for (const int32_t value : values) ptr = write_u32(ptr, value);
+        }
+
+        void unpack(const uint8_t *ptr) {
+            int32_t *values[] = {
+                (int32_t *)&ticks, &pen_temperature_mc, &set_point_mc, &cpu_temperature_mc,
+                &requested_power_mw, &power_mw, &supply_voltage_mv_idle, &supply_voltage_mv_heat,
+                &pen_current_ma, &pen_resistance_mo, &pid_p, &pid_i, &pid_d,
+                &estimated_temperature_mc,
+            };
+            for (int32_t *value : values) {
+                *value = read_u32(ptr);
+                ptr += 4;
+            }
+        }
+    };
+
+    static const int PAYLOAD_SIZE_MAX = Control::SIZE;
+    static const int FRAME_SIZE_MAX = lib::Cobs::encoded_size(1 + PAYLOAD_SIZE_MAX + 2) + 1;
+
+    static uint8_t *write_u32(uint8_t *ptr, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            *ptr++ = value;
+            value >>= 8;
+        }
+        return ptr;
+    }
+
+    static uint32_t read_u32(const uint8_t *ptr) {
+        return ptr[0] | ptr[1] << 8 | ptr[2] << 16 | (uint32_t)ptr[3] << 24;
+    }
+
+    /** Build frame
+
+    Arguments:
+        type: type of frame
+        payload: data of frame
+        len: size of payload (maximum PAYLOAD_SIZE_MAX)
+        frame: buffer for frame with size FRAME_SIZE_MAX
+
+    Return:
+        size of frame including delimiter
+    */
+    static int encode(const Type type, const uint8_t *payload, const int len, uint8_t *frame) {
+        uint8_t data[1 + PAYLOAD_SIZE_MAX + 2];
+        data[0] = static_cast<uint8_t>(type);
+        for (int i = 0; i < len; i++) data[1 + i] = payload[i];
+        uint16_t crc = lib::Crc16::update(data, 1 + len);
+        data[1 + len] = crc;
+        data[2 + len] = crc >> 8;
+        int size = lib::Cobs::encode(data, len + 3, frame);
+        frame[size++] = lib::Cobs::DELIMITER;
+        return size;
+    }
+
+    /** Decode frame
+
+    Arguments:
+        frame: frame without delimiter
+        len: size of frame
+        type: returned type of frame
+        payload: buffer for payload with size at least len
+
+    Return:
+        size of payload or -1 if frame is not valid
+    */
+    static int decode(const uint8_t *frame, const int len, Type &type, uint8_t *payload) {
+        int size = lib::Cobs::decode(frame, len, payload);
+        if (size < 3) return -1;
+        size -= 2;
+        if (lib::Crc16::update(payload, size) != (payload[size] | payload[size + 1] << 8)) return -1;
+        type = static_cast<Type>(payload[0]);
+        size -= 1;
+        for (int i = 0; i < size; i++) payload[i] = payload[i + 1];
+        return size;
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include "board/adc.hpp"
+
+/** Profiles of RT tips
+
+Tip is identified by resistance of heating element measured in first
+heating pulse after it is inserted, while it is cold (Heating does not
+identify hot tip, because resistance of heater rise with temperature).
+Profile keep PID gains tuned for tip and power supply, not tuned profile
+use default gains.
+
+Profile also keep calibration of thermocouple (offset and gain of
+temperature difference to cold junction), which is applied by
+board::Adc. Calibration is learned from reference temperatures (external
+thermometer): one point correct offset, two points correct also gain.
+*/
+class Tips {
+public:
+    static const int PROFILES = 4;
+    static const int NO_TIP = -1;
+
+    struct Profile {
+        int resistance_mo;  // mOhm, 0 if profile is not used
+        int pid_p;  // mW/C, 0 if profile is not tuned
+        int pid_i;  // mW/(C*s)
+        int pid_d;  // mW*s/C
+        int temperature_offset_mc;  // 1/1000 degree C
+        int temperature_gain;  // Q board::Adc::PEN_GAIN_Q, 0 if profile is not calibrated
+
+        bool is_tuned() const {
+            return pid_p > 0;
+        }
+
+        bool is_calibrated() const {
+            return temperature_gain > 0;
+        }
+
+        int32_t get_temperature_gain() const {
+            return is_calibrated() ? temperature_gain : GAIN_ONE;
+        }
+    };
+
+private:
+    static const int RESISTANCE_TOLERANCE_MO = 100;  // mOhm
+    static const int32_t GAIN_ONE = (int32_t)1 << board::Adc::PEN_GAIN_Q;
+    static const int CALIBRATION_DISTANCE_MC = 50000;  // minimal distance of two points
+    static const int32_t GAIN_MIN = GAIN_ONE / 2;
+    static const int32_t GAIN_MAX = GAIN_ONE * 2;
+    static const int OFFSET_MAX_MC = 50000;  // maximal correction of thermocouple offset
+
+    Profile _profiles[PROFILES] = {};
+    int _active = NO_TIP;
+    int _replace = 0;  // next profile replaced when all are used
+
+    // first point of two point calibration (uncalibrated and reference difference)
+    bool _calibration_point = false;
+    int _calibration_raw_mc = 0;
+    int _calibration_reference_mc = 0;
+
+public:
+    /** Find profile of inserted tip or create new one
+
+    Arguments:
+        resistance_mo: measured resistance of heating element in mOhm
+
+    Return:
+        index of active profile
+    */
+    int identify(const int resistance_mo) {
+        int best = NO_TIP;
+        int best_diff = RESISTANCE_TOLERANCE_MO + 1;
+        int empty = NO_TIP;
+        for (int i = 0; i < PROFILES; i++) {
+            if (!_profiles[i].resistance_mo) {
+                if (empty == NO_TIP) empty = i;
+                continue;
+            }
+            int diff = _profiles[i].resistance_mo - resistance_mo;
+            if (diff < 0) diff = -diff;
+            if (diff < best_diff) {
+                best = i;
+                best_diff = diff;
+            }
+        }
+        if (best == NO_TIP) {
+            if (empty == NO_TIP) {
+                empty = _replace;
+                _replace = (_replace + 1) % PROFILES;
+            }
+            best = empty;
+            _profiles[best] = {};
+            _profiles[best].resistance_mo = resistance_mo;
+        }
+        _active = best;
+        _calibration_point = false;
+        return _active;
+    }
+
+    /** Tip was removed
+    */
+    void remove() {
+        _active = NO_TIP;
+        _calibration_point = false;
+    }
+
+    /** Add calibration point of inserted tip
+
+    First point correct offset (gain of profile is kept), next point
+    which is far enough from first one correct also gain.
+
+    Arguments:
+        measured_mc: measured temperature difference with actual calibration
+        reference_mc: reference temperature difference
+
+    Return:
+        number of used points (1 or 2), 0 if tip is not identified
+        or gain or offset is out of range
+    */
+    int calibrate(const int measured_mc, const int reference_mc) {
+        Profile *profile = get_active();
+        if (!profile) return 0;
+        int32_t gain = profile->get_temperature_gain();
+        int raw_mc = ((int64_t)(measured_mc - profile->temperature_offset_mc) << board::Adc::PEN_GAIN_Q) / gain;
+        int diff = raw_mc - _calibration_raw_mc;
+        if (diff < 0) diff = -diff;
+        int points = 1;
+        if (_calibration_point && diff >= CALIBRATION_DISTANCE_MC) {
+            gain = ((int64_t)(reference_mc - _calibration_reference_mc) << board::Adc::PEN_GAIN_Q) / (raw_mc - _calibration_raw_mc);
+            if (gain < GAIN_MIN || gain > GAIN_MAX) return 0;
+            points = 2;
+        }
+        int offset_mc = reference_mc - (((int64_t)raw_mc * gain) >> board::Adc::PEN_GAIN_Q);
+        if (offset_mc < -OFFSET_MAX_MC || offset_mc > OFFSET_MAX_MC) return 0;
+        profile->temperature_gain = gain;
+        profile->temperature_offset_mc = offset_mc;
+        // after two points next point start new pair
+        _calibration_point = points == 1;
+        _calibration_raw_mc = raw_mc;
+        _calibration_reference_mc = reference_mc;
+        return points;
+    }
+
+    bool is_identified() const {
+        return _active != NO_TIP;
+    }
+
+    int get_active_index() const {
+        return _active;
+    }
+
+    /** Profile by index (for settings)
+
+    Arguments:
+        index: index of profile 0 .. PROFILES - 1
+    */
+    Profile &get_profile(const int index) {
+        return _profiles[index];
+    }
+
+    const Profile &get_profile(const int index) const {
+        return _profiles[index];
+    }
+
+    /** Profile of inserted tip
+
+    Return:
+        active profile or nullptr if tip is not identified
+    */
+    Profile *get_active() {
+        if (_active == NO_TIP) return nullptr;
+        return &_profiles[_active];
+    }
+};
@@ -0,0 +1,3 @@
+#include "trace.hpp"
+
+Trace trace;
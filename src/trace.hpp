@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include "board/systick.hpp"
+#include "board/debug.hpp"
+#include "lib/fifo.hpp"
+#include "telemetry.hpp"
+
+/** Binary trace of heating cycle events
+
+Records are stored into FIFO and later streamed by drain() over debug
+UART. Each record is sent as telemetry frame of type TRACE with payload:
+event, parameter, timestamp in ticks (32 bit) and value (32 bit).
+
+Records can be added only from main loop (single producer),
+drain is also called from main loop.
+Trace is disabled after start to keep UART bandwidth for telemetry,
+firmware built with option TRACE (cmake -DTRACE=ON) enables it in
+MainClass::run() before heating is started.
+*/
+class Trace {
+public:
+    enum class Event : uint8_t {
+        STATE,  // param: new state of heating
+        POWER_REQUEST,  // value: requested power in mW
+        PEN_TEMPERATURE,  // value: measured temperature in 1/1000 degree C
+        PEN_CURRENT,  // value: heating current in mA
+        SUPPLY_VOLTAGE,  // param: 0 idle, 1 heating, value: voltage in mV
+        OVERFLOW,  // value: number of lost records
+    };
+
+    static const int SIZE = 32;
+
+private:
+    struct Record {
+        uint32_t ticks;
+        int32_t value;
+        Event event;
+        uint8_t param;
+    };
+
+    static const int RECORD_SIZE = 10;  // size of payload
+
+    lib::Fifo<Record, SIZE> _fifo;
+    bool _enabled = false;
+    int _lost = 0;
+
+    void _push(const Record &record) {
+        if (_fifo.push(record)) return;
+        _lost++;
+    }
+
+public:
+    void enable(bool enabled=true) {
+        _enabled = enabled;
+        _fifo.reset();
+        _lost = 0;
+    }
+
+    bool is_enabled() const {
+        return _enabled;
+    }
+
+    /** Add record with actual timestamp
+
+    Arguments:
+        event: type of event
+        param: parameter of event
+        value: value of event
+    */
+    void record(const Event event, const uint8_t param=0, const int32_t value=0) {
+        if (!_enabled) return;
+        if (_lost) {
+            if (_fifo.get_free() < 2) {
+                _lost++;
+                return;
+            }
+            _push({static_cast<uint32_t>(board::systick.get_ticks()), _lost, Event::OVERFLOW, 0});
+            _lost = 0;
+        }
+        _push({static_cast<uint32_t>(board::systick.get_ticks()), value, event, param});
+    }
+
+    /** Stream records over debug UART while its output buffer has space
+
+    Arguments:
+        delta_ticks: not used
+
+    Return:
+        false, trace does not need to run again without sleep
+    */
+    bool drain(unsigned) {
+        Record record;
+        while (board::debug.uart.get_tx_free() >= Telemetry::FRAME_SIZE_MAX && _fifo.pull(record)) {
+            uint8_t payload[RECORD_SIZE];
+            uint8_t *ptr = payload;
+            *ptr++ = static_cast<uint8_t>(record.event);
+            *ptr++ = record.param;
+            ptr = Telemetry::write_u32(ptr, record.ticks);
+            Telemetry::write_u32(ptr, record.value);
+            uint8_t frame[Telemetry::FRAME_SIZE_MAX];
+            int size = Telemetry::encode(Telemetry::Type::TRACE, payload, RECORD_SIZE, frame);
+            board::debug.uart.write_data(reinterpret_cast<char *>(frame), size);
+        }
+        return false;
+    }
+};
+
+extern Trace trace;